@@ -0,0 +1,179 @@
+#ifndef CONTROLAUDIT_H
+#define CONTROLAUDIT_H
+
+#include <qglobal.h>
+#include <qvector.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qfile.h>
+#include <qtextstream.h>
+#include <qdebug.h>
+#include "ControlClock.h"
+
+#define AUDITDEPTH 1024 // decisions kept by the audit log (the oldest ones are overwritten)
+#define AUDITFILE "ControlDecisions.csv"
+
+// CONTROL DECISION CLASS - one decision of the load control: why, on which inputs, against which threshold and how fast the pool followed
+
+class ControlDecision
+{
+
+public:
+	enum Reason { NoReason, OverloadReason, DelayReason, PreemptReason, MissReason, SloReason, UnderloadReason, UpLockReason, WaitReason, SaturateReason,
+		LimitReason, CeilingReason, SearchReason, BanditReason, ModelReason, TrackReason, ShiftReason, DownLockReason };
+
+	Reason Cause = NoReason;
+	qint64 Sample = 0; // ns since the start of the log the triggering sample came at
+	int From = 0; // thread number the decision was made at
+	int To = 0; // thread number decided (From - the decision held)
+	qreal Input = 0; // value the rule looked at (mean task time, share, throughput...)
+	qreal Error = 0; // standard error of the input (0 if the rule doesn't test significance)
+	qreal Threshold = 0; // value in force the input was compared with
+	int Samples = 0; // tasks or probes behind the input
+	qint64 Latency = -1; // us from the finish of the triggering task to the applied pool change (-1 - held or not applied)
+	int Repeats = 1; // same holds in a row merged into the record
+
+	static inline QString reasonString(Reason reason);
+	inline QString toString(); // one line of the log view
+	inline QString toCsv();
+	static QString csvHeader() { return "time_ms,reason,from,to,input,error,threshold,samples,latency_us,repeats"; }
+};
+
+QString ControlDecision::reasonString(Reason reason)
+{
+	switch (reason)
+	{
+	case OverloadReason: return QString("overload");
+	case DelayReason: return QString("run queue delay");
+	case PreemptReason: return QString("preemption");
+	case MissReason: return QString("deadline misses");
+	case SloReason: return QString("slo");
+	case UnderloadReason: return QString("underload");
+	case UpLockReason: return QString("up lock");
+	case WaitReason: return QString("wait");
+	case SaturateReason: return QString("saturation");
+	case LimitReason: return QString("thread limit");
+	case CeilingReason: return QString("host ceiling");
+	case SearchReason: return QString("search");
+	case BanditReason: return QString("bandit");
+	case ModelReason: return QString("model");
+	case TrackReason: return QString("tracking");
+	case ShiftReason: return QString("workload change");
+	case DownLockReason: return QString("down lock");
+	default: return QString("none");
+	}
+}
+
+QString ControlDecision::toString()
+{
+	QString line = QString("%1 s  %2 -> %3  %4 | input %5").arg(Sample / 1e9, 9, 'f', 3).arg(From, 3).arg(To, 3).arg(reasonString(Cause), -16).arg(Input, 0, 'g', 4);
+	if (Error > 0) line += QString(" +-%1").arg(Error, 0, 'g', 3);
+	line += QString(" threshold %1 (%2 samples)").arg(Threshold, 0, 'g', 4).arg(Samples);
+	if (Latency >= 0) line += QString(" applied in %1 us").arg(Latency);
+	if (Repeats > 1) line += QString(" x%1").arg(Repeats);
+	return line;
+}
+
+QString ControlDecision::toCsv()
+{
+	return (QStringList() << QString::number(Sample / 1e6, 'f', 3) << reasonString(Cause) << QString::number(From) << QString::number(To) << QString::number(Input, 'g', 6)
+		<< QString::number(Error, 'g', 4) << QString::number(Threshold, 'g', 6) << QString::number(Samples) << QString::number(Latency) << QString::number(Repeats)).join(',');
+}
+
+
+// DECISION LOG CLASS - ring buffer of the last decisions (no allocation or formatting on the control path)
+
+class DecisionLog
+{
+
+public:
+	DecisionLog(int depth = AUDITDEPTH) { Records.resize(qMax(depth, 1)); clear(); }
+
+	void clear() { Next = 0; Count = 0; Pending = -1; SampleTime = 0; Current = ControlDecision(); Clock.start(); }
+	void setSource(ClockSource* source) { Clock.setSource(source); clear(); }
+	int count() { return Count; }
+	ControlDecision& at(int i) { return Records[(Next - Count + i + Records.count()) % Records.count()]; } // 0 - the oldest kept decision
+	void sample(qint64 age = 0) { SampleTime = Clock.nsecsElapsed() - age; Current = ControlDecision(); } // a triggering sample came, taken 'age' ns ago (the cause of the last one is forgotten)
+	bool hasCause() { return Current.Cause != ControlDecision::NoReason; }
+	inline void cause(ControlDecision::Reason reason, qreal input, qreal threshold, int samples = 0, qreal error = 0); // the rule that fired and what it saw
+	inline void decide(int from, int to, ControlDecision::Reason reason = ControlDecision::NoReason); // records the decision on the last cause (reason - overrides it)
+	inline void applied(int count); // the pool changed to 'count' threads
+	inline QStringList lines(); // oldest first
+	inline bool save(QString path = AUDITFILE);
+
+private:
+	QVector<ControlDecision> Records;
+	int Next; // slot of the next record
+	int Count; // records kept
+	int Pending; // slot of the decision waiting for its pool change (-1 if none)
+	qint64 SampleTime; // ns of the last triggering sample
+	ControlDecision Current; // cause of the decision being made
+	ClockTimer Clock;
+};
+
+void DecisionLog::cause(ControlDecision::Reason reason, qreal input, qreal threshold, int samples, qreal error)
+{
+	Current.Cause = reason;
+	Current.Input = input;
+	Current.Threshold = threshold;
+	Current.Samples = samples;
+	Current.Error = error;
+}
+
+void DecisionLog::decide(int from, int to, ControlDecision::Reason reason)
+{
+	ControlDecision decision = Current;
+	if (reason != ControlDecision::NoReason) decision.Cause = reason;
+	if (decision.Cause == ControlDecision::NoReason) decision.Cause = ControlDecision::WaitReason; // no rule had enough data
+	decision.Sample = SampleTime;
+	decision.From = from;
+	decision.To = to;
+	if (from == to && Count > 0) // holds in a row are one record
+	{
+		ControlDecision& last = at(Count - 1);
+		if (last.From == from && last.To == to && last.Cause == decision.Cause)
+		{
+			decision.Sample = last.Sample;
+			decision.Repeats = last.Repeats + 1;
+			last = decision;
+			return;
+		}
+	}
+	if (Pending == Next) Pending = -1; // overwritten before it was applied
+	Records[Next] = decision;
+	if (from != to) Pending = Next;
+	Next = (Next + 1) % Records.count();
+	if (Count < Records.count()) Count++;
+}
+
+void DecisionLog::applied(int count)
+{
+	if (Pending < 0)
+		return;
+	ControlDecision& decision = Records[Pending];
+	decision.Latency = (Clock.nsecsElapsed() - decision.Sample) / 1000;
+	if (count == decision.To) Pending = -1; // jumps are applied thread by thread
+}
+
+QStringList DecisionLog::lines()
+{
+	QStringList lines;
+	for (int i = 0; i < Count; i++) lines << at(i).toString();
+	return lines;
+}
+
+bool DecisionLog::save(QString path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+	{
+		qDebug() << "decisionlog: unable to complete action | couldn't write" << path;
+		return false;
+	}
+	QTextStream stream(&file);
+	stream << ControlDecision::csvHeader() << "\n";
+	for (int i = 0; i < Count; i++) stream << at(i).toCsv() << "\n";
+	return true;
+}
+
+#endif // CONTROLAUDIT_H
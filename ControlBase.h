@@ -0,0 +1,663 @@
+#ifndef CONTROLBASE_H
+#define CONTROLBASE_H
+
+#include <qglobal.h>
+#include <qdebug.h>
+#include <qvector.h>
+#include <qpoint.h>
+#include <qmap.h>
+#include <math.h>
+#include <random>
+
+#define HISTOGRAMDEPTH 64 // number of histogram buckets
+#define STEADYDEPTH 10 // number of tracking samples the steady state error is averaged over
+#define CYCLEDEPTH 64 // number of thread numbers kept by the oscillation detector (cycles up to half of it are found)
+
+// TIME HISTOGRAM CLASS - log scaled histogram of task times for percentiles (bucket i keeps times up to Base * Step^i)
+
+class TimeHistogram
+{
+
+public:
+	TimeHistogram(qreal base = 1.0, qreal step = 1.25) : Base(base), Step(step) { clear(); }
+
+	inline void add(qreal ms);
+	inline qreal percentile(qreal share); // returns time (ms) below which 'share' (0..1) of the times are, 0 if empty
+	quint64 count() { return Count; }
+	qreal mean() { if (Count == 0) { return 0.0; } else { return Sum / Count; }}
+	qreal max() { return Max; }
+	void clear() { for (int i = 0; i < HISTOGRAMDEPTH; i++) Buckets[i] = 0; Count = 0; Sum = 0; Max = 0; }
+
+private:
+	quint64 Buckets[HISTOGRAMDEPTH];
+	quint64 Count;
+	qreal Sum; // ms
+	qreal Max; // ms
+	const qreal Base; // ms, upper bound of the first bucket
+	const qreal Step; // ratio of neighbour bucket bounds
+};
+
+void TimeHistogram::add(qreal ms)
+{
+	int bucket = 0;
+	if (ms > Base) bucket = qMin((int)ceil(log(ms / Base) / log(Step)), HISTOGRAMDEPTH - 1);
+	Buckets[bucket]++;
+	Count++;
+	Sum += ms;
+	if (ms > Max) Max = ms;
+}
+
+qreal TimeHistogram::percentile(qreal share)
+{
+	if (Count == 0)
+		return 0.0;
+	quint64 rank = (quint64)ceil(qBound(0.0, share, 1.0) * Count);
+	quint64 counted = 0;
+	for (int i = 0; i < HISTOGRAMDEPTH; i++)
+	{
+		counted += Buckets[i];
+		if (counted >= rank && counted > 0)
+			return qMin(Base * pow(Step, i), Max);
+	}
+	return Max;
+}
+
+// RUNNING STATS CLASS - running mean and variance of task times (welford) with significance tests against a measured threshold
+
+class RunningStats
+{
+
+public:
+	RunningStats() { clear(); }
+
+	void add(qreal x) { Count++; qreal delta = x - Mean; Mean += delta / Count; Squares += delta * (x - Mean); }
+	quint64 count() { return Count; }
+	qreal mean() { return Mean; }
+	qreal variance() { if (Count < 2) { return 0.0; } else { return Squares / (Count - 1); }}
+	qreal error() { if (Count < 2) { return 0.0; } else { return sqrt(variance() / Count); }} // standard error of the mean
+	void clear() { Count = 0; Mean = 0; Squares = 0; }
+	inline bool isAbove(qreal threshold, qreal threshold_error, qreal z); // mean is significantly above the threshold (welch t test, threshold_error - standard error of a measured threshold)
+	inline bool isBelow(qreal threshold, qreal threshold_error, qreal z);
+	inline int required(qreal precision, qreal z); // tasks needed for the mean within +-precision (relative) at the z confidence
+	static qreal critical(qreal z, qreal dof) { return z + (z * z * z + z) / (4 * qMax(dof, 1.0)); } // student t quantile approximated from the normal one
+
+private:
+	quint64 Count;
+	qreal Mean;
+	qreal Squares; // sum of squared deviations from the mean
+};
+
+bool RunningStats::isAbove(qreal threshold, qreal threshold_error, qreal z)
+{
+	if (Count < 2)
+		return false;
+	qreal error = sqrt(variance() / Count + threshold_error * threshold_error);
+	if (error == 0) return Mean > threshold;
+	return (Mean - threshold) / error > critical(z, Count - 1);
+}
+
+bool RunningStats::isBelow(qreal threshold, qreal threshold_error, qreal z)
+{
+	if (Count < 2)
+		return false;
+	qreal error = sqrt(variance() / Count + threshold_error * threshold_error);
+	if (error == 0) return Mean < threshold;
+	return (threshold - Mean) / error > critical(z, Count - 1);
+}
+
+int RunningStats::required(qreal precision, qreal z)
+{
+	if (Count < 2 || Mean <= 0)
+		return 0;
+	qreal n = z * sqrt(variance()) / (precision * Mean);
+	return (int)ceil(n * n);
+}
+
+// WARMUP DETECTOR CLASS - decides when task times after a thread change stop trending (slope test over a moving window)
+
+class WarmupDetector
+{
+
+public:
+	WarmupDetector(int window = 5, int limit = 36) : Window(qMax(window, 3)), Limit(qMax(limit, window)) { start(); }
+
+	void start(int drain = 0) { Times.clear(); Count = 0; Drain = qMax(drain, 0); Over = false; } // the first 'drain' tasks are skipped
+	inline bool add(qreal ms); // returns true once the times are steady (till the next start)
+	bool isOver() { return Over; }
+	int count() { return Count; } // tasks seen since the start
+
+private:
+	QVector<qreal> Times; // last task times
+	int Count;
+	int Drain; // tasks in flight at the change (they ran under the old thread number)
+	bool Over;
+	const int Window; // tasks the slope is fitted over
+	const int Limit; // tasks after the drain the warm-up is over anyway
+	const qreal Trend = 0.05; // change over the window (relative to its mean) treated as steady
+	const qreal SlopeZ = 1.0; // slope within this number of its standard errors is lost in the noise
+};
+
+bool WarmupDetector::add(qreal ms)
+{
+	if (Over)
+		return true;
+	Count++;
+	if (Count <= Drain) // dispatched before the change, the slope is tested on the new thread number only
+		return false;
+	Times.append(ms);
+	if (Times.count() > Window) Times.remove(0);
+	if (Count >= Drain + Limit)
+		return Over = true;
+	if (Times.count() < Window)
+		return false;
+	qreal n = Times.count(), mean_x = (n - 1) / 2, mean_y = 0;
+	foreach (qreal time, Times) mean_y += time / n;
+	qreal sxx = 0, sxy = 0;
+	for (int i = 0; i < Times.count(); i++) { sxx += (i - mean_x) * (i - mean_x); sxy += (i - mean_x) * (Times[i] - mean_y); }
+	qreal slope = sxy / sxx;
+	qreal residual = 0;
+	for (int i = 0; i < Times.count(); i++) { qreal r = Times[i] - mean_y - slope * (i - mean_x); residual += r * r; }
+	qreal error = sqrt(residual / (n - 2) / sxx); // standard error of the slope
+	if (mean_y <= 0 || fabs(slope) * (n - 1) < Trend * mean_y || fabs(slope) < SlopeZ * error) // flat or the trend is lost in the noise
+		Over = true;
+	return Over;
+}
+
+// CHANGE DETECTOR CLASS - two-sided page-hinkley test of a signal's level (alarms when the level shifts for good)
+
+class ChangeDetector
+{
+
+public:
+	ChangeDetector(qreal tolerance = 0.1, qreal threshold = 1.0) : Tolerance(tolerance), Threshold(threshold) { clear(); }
+
+	inline int add(qreal x); // returns +1 if the level went up, -1 if it went down, 0 if no change (the test restarts after an alarm)
+	qreal mean() { return Mean; }
+	int count() { return Count; }
+	void clear() { Count = 0; Mean = 0; Up = 0; UpMin = 0; Down = 0; DownMax = 0; }
+
+private:
+	const qreal Tolerance; // deviation from the mean treated as noise (delta)
+	const qreal Threshold; // cumulative deviation raising the alarm (lambda)
+	int Count;
+	qreal Mean;
+	qreal Up; // cumulative deviation over the mean and its minimum
+	qreal UpMin;
+	qreal Down; // cumulative deviation under the mean and its maximum
+	qreal DownMax;
+};
+
+int ChangeDetector::add(qreal x)
+{
+	Count++;
+	Mean += (x - Mean) / Count;
+	Up += x - Mean - Tolerance;
+	UpMin = qMin(UpMin, Up);
+	Down += x - Mean + Tolerance;
+	DownMax = qMax(DownMax, Down);
+	int shift = 0;
+	if (Up - UpMin > Threshold) shift = 1;
+	else if (DownMax - Down > Threshold) shift = -1;
+	if (shift != 0) clear();
+	return shift;
+}
+
+// DEADLINE METER CLASS - deadline miss rate and lateness distribution of the tasks carrying deadlines
+
+class DeadlineMeter
+{
+
+public:
+	DeadlineMeter() { clear(); }
+
+	void add(qreal lateness) { Count++; if (lateness > 0) { Misses++; Lateness.add(lateness); }} // ms after the deadline (<= 0 - met)
+	quint64 count() { return Count; }
+	quint64 misses() { return Misses; }
+	qreal missRate() { if (Count == 0) { return 0.0; } else { return (qreal)Misses / Count; }}
+	TimeHistogram& lateness() { return Lateness; } // lateness of the missed tasks
+	void clear() { Count = 0; Misses = 0; Lateness.clear(); }
+
+private:
+	quint64 Count;
+	quint64 Misses;
+	TimeHistogram Lateness;
+};
+
+// USL MODEL CLASS - universal scalability law X(N) = Lambda * N / (1 + Sigma * (N - 1) + Kappa * N * (N - 1)) fitted to throughput per thread number
+
+class UslModel
+{
+
+public:
+	UslModel() { clear(); }
+
+	inline bool fit(const QVector<QPointF>& points); // points are (thread number, tasks/sec), returns true if the model is valid (3+ thread numbers)
+	qreal throughput(qreal n) { if (!Valid) { return 0.0; } else { return Lambda * n / (1 + penalty(n)); }} // tasks/sec of n threads
+	qreal taskTime(qreal n) { if (!Valid) { return 0.0; } else { return 1000 * (1 + penalty(n)) / Lambda; }} // ms of one task with n threads running
+	qreal taskTimeInterval(qreal n) { if (!Valid) { return 0.0; } else { return 1000 * 2 * penaltyError(n) / Lambda; }} // half width of ~95% band of the task time
+	qreal peak() { if (!Valid || Kappa <= 0 || Sigma >= 1) { return 0.0; } else { return sqrt((1 - Sigma) / Kappa); }} // thread number of max throughput (0 - no retrograde part)
+	bool isValid() { return Valid; }
+	qreal getLambda() { return Lambda; } // tasks/sec of one thread
+	qreal getSigma() { return Sigma; } // contention
+	qreal getKappa() { return Kappa; } // coherency
+	void clear() { Lambda = 0; Sigma = 0; Kappa = 0; Valid = false; for (int i = 0; i < 3; i++) Covariance[i] = 0; }
+
+private:
+	qreal Lambda;
+	qreal Sigma;
+	qreal Kappa;
+	bool Valid;
+	qreal Covariance[3]; // of the linear coefficients a = Sigma + Kappa, b = Kappa: aa, ab, bb
+
+	qreal penalty(qreal n) { return Sigma * (n - 1) + Kappa * n * (n - 1); } // N / C(N) - 1 (C - relative capacity)
+	qreal penaltyError(qreal n) { qreal x = n - 1; return sqrt(qMax(0.0, x * x * Covariance[0] + 2 * x * x * x * Covariance[1] + x * x * x * x * Covariance[2])); }
+	inline qreal fitPenalty(const QVector<QPointF>& points, qreal lambda); // least squares of the penalty for the given lambda, returns squared throughput error
+};
+
+qreal UslModel::fitPenalty(const QVector<QPointF>& points, qreal lambda)
+{
+	// N / C(N) - 1 = a * x + b * x^2, x = N - 1 (linear least squares through the origin)
+	qreal sx2 = 0, sx3 = 0, sx4 = 0, sxy = 0, sx2y = 0;
+	foreach (QPointF point, points)
+	{
+		qreal x = point.x() - 1;
+		qreal y = lambda * point.x() / point.y() - 1;
+		sx2 += x * x; sx3 += x * x * x; sx4 += x * x * x * x;
+		sxy += x * y; sx2y += x * x * y;
+	}
+	qreal det = sx2 * sx4 - sx3 * sx3;
+	if (sx2 <= 0 || det <= 0)
+		return -1.0;
+	qreal a = (sxy * sx4 - sx2y * sx3) / det;
+	qreal b = (sx2y * sx2 - sxy * sx3) / det;
+	if (b < 0) { b = 0; a = sxy / sx2; } // no coherency cost
+	if (a < b) { b = (sxy + sx2y) / (sx2 + 2 * sx3 + sx4); a = b; } // no contention cost: y = b * (x + x^2)
+	if (b < 0) { b = 0; a = 0; }
+	Lambda = lambda;
+	Sigma = a - b;
+	Kappa = b;
+
+	qreal error = 0, penalty_error = 0;
+	foreach (QPointF point, points)
+	{
+		qreal x = point.x() - 1;
+		qreal y = lambda * point.x() / point.y() - 1;
+		penalty_error += pow(y - a * x - b * x * x, 2);
+		error += pow(point.y() - throughput(point.x()), 2);
+	}
+	qreal variance = (points.count() > 2) ? penalty_error / (points.count() - 2) : 0.0;
+	Covariance[0] = variance * sx4 / det;
+	Covariance[1] = -variance * sx3 / det;
+	Covariance[2] = variance * sx2 / det;
+	return error;
+}
+
+bool UslModel::fit(const QVector<QPointF>& points)
+{
+	clear();
+	qreal lambda = 0, per_thread = 0;
+	foreach (QPointF point, points)
+	{
+		if (point.x() < 1 || point.y() <= 0) return false;
+		if (point.x() == 1) lambda = point.y();
+		per_thread = qMax(per_thread, point.y() / point.x());
+	}
+	if (points.count() < 3)
+		return false;
+	Valid = true; // throughput() is used by the fitting
+	if (lambda > 0) // single thread is measured -> lambda is known
+	{
+		if (fitPenalty(points, lambda) < 0) { clear(); return false; }
+	}
+	else // golden section search of lambda by the throughput error
+	{
+		const qreal ratio = (sqrt(5.0) - 1) / 2;
+		qreal low = per_thread, high = 4 * per_thread;
+		for (int i = 0; i < 40; i++)
+		{
+			qreal left = high - ratio * (high - low), right = low + ratio * (high - low);
+			qreal left_error = fitPenalty(points, left), right_error = fitPenalty(points, right);
+			if (left_error < 0 || right_error < 0) { clear(); return false; }
+			if (left_error < right_error) high = right; else low = left;
+		}
+		fitPenalty(points, (low + high) / 2);
+	}
+	return true;
+}
+
+// GOLDEN SEARCH CLASS - golden section search of the thread number with the most throughput (a tie within the noise shrinks both sides like ternary search)
+
+class GoldenSearch
+{
+
+public:
+	GoldenSearch() { clear(); }
+
+	void start(int low, int high) { clear(); Low = qMax(low, 1); High = qMax(high, Low); Over = false; }
+	inline int next(); // returns the thread number to measure next (0 - the search is over)
+	void measured(int n, qreal throughput) { Measured.insert(n, throughput); }
+	inline int best(); // measured thread number with the most throughput (0 if nothing is measured)
+	bool isOver() { return Over; }
+	int probes() { return Measured.count(); }
+	void clear() { Low = 1; High = 1; Over = true; Measured.clear(); }
+
+private:
+	int Low; // bracket of the peak
+	int High;
+	bool Over;
+	QMap<int, qreal> Measured; // throughput of the probed thread numbers
+	const qreal Tolerance = 0.03; // relative throughput difference treated as noise
+};
+
+int GoldenSearch::next()
+{
+	const qreal ratio = (sqrt(5.0) - 1) / 2;
+	while (!Over)
+	{
+		if (High - Low <= 2) // small bracket -> measure what's left of it
+		{
+			for (int n = Low; n <= High; n++)
+				if (!Measured.contains(n)) return n;
+			Over = true;
+			break;
+		}
+		int left = High - (int)round(ratio * (High - Low));
+		int right = Low + (int)round(ratio * (High - Low));
+		if (right <= left) right = left + 1;
+		if (!Measured.contains(left)) return left;
+		if (!Measured.contains(right)) return right;
+		qreal left_throughput = Measured.value(left), right_throughput = Measured.value(right);
+		if (fabs(left_throughput - right_throughput) <= Tolerance * qMax(left_throughput, right_throughput)) { Low = left; High = right; } // peak is between them
+		else if (left_throughput < right_throughput) Low = left;
+		else High = right;
+	}
+	return 0;
+}
+
+int GoldenSearch::best()
+{
+	int best = 0;
+	foreach (int n, Measured.keys())
+	{
+		if (best == 0 || Measured.value(n) > Measured.value(best)) best = n;
+	}
+	return best;
+}
+
+// THREAD BANDIT CLASS - thread numbers as arms of a multi-armed bandit with discounted gaussian posteriors of throughput
+
+class ThreadBandit
+{
+
+public:
+	enum BanditRule { ThompsonRule, UcbRule };
+
+	ThreadBandit(quint32 seed = 1) : Generator(seed) { start(1); }
+
+	void start(int arms, BanditRule rule = ThompsonRule) { Rule = rule; Weights.fill(0.0, qMax(arms, 1)); Sums.fill(0.0, qMax(arms, 1)); Squares.fill(0.0, qMax(arms, 1)); }
+	inline void update(int arm, qreal throughput); // adds a window of the thread number, older windows fade out
+	inline int choose(int limit); // thread number for the next window (1..limit)
+	qreal mean(int arm) { if (arm < 1 || arm > Weights.count() || Weights[arm - 1] == 0) { return 0.0; } else { return Sums[arm - 1] / Weights[arm - 1]; }}
+	qreal weight(int arm) { if (arm < 1 || arm > Weights.count()) { return 0.0; } else { return Weights[arm - 1]; }} // discounted number of windows
+	void setSeed(quint32 seed) { Generator.seed(seed); }
+
+private:
+	BanditRule Rule;
+	QVector<qreal> Weights;
+	QVector<qreal> Sums;
+	QVector<qreal> Squares;
+	std::mt19937 Generator;
+	const qreal Discount = 0.97; // weight kept by the old windows with every new one (drift adaptation)
+	const qreal Exploration = 1.0; // ucb bonus multiplier
+
+	inline qreal noise(); // pooled standard deviation of a window's throughput
+	inline void prior(int arm, qreal* mean, qreal* deviation); // posterior of the arm (the nearest measured arm with a wide spread if not measured)
+};
+
+void ThreadBandit::update(int arm, qreal throughput)
+{
+	if (arm < 1 || arm > Weights.count())
+		return;
+	for (int i = 0; i < Weights.count(); i++)
+	{
+		Weights[i] *= Discount;
+		Sums[i] *= Discount;
+		Squares[i] *= Discount;
+	}
+	Weights[arm - 1] += 1;
+	Sums[arm - 1] += throughput;
+	Squares[arm - 1] += throughput * throughput;
+}
+
+qreal ThreadBandit::noise()
+{
+	qreal scatter = 0, weight = 0, level = 0;
+	for (int i = 0; i < Weights.count(); i++)
+	{
+		if (Weights[i] > 1)
+		{
+			scatter += qMax(0.0, Squares[i] - Sums[i] * Sums[i] / Weights[i]);
+			weight += Weights[i] - 1;
+		}
+		if (Weights[i] > 0) level = qMax(level, Sums[i] / Weights[i]);
+	}
+	if (weight < 1) return 0.1 * level; // not enough repeated windows -> 10% of the throughput
+	return qMax(sqrt(scatter / weight), 0.01 * level);
+}
+
+void ThreadBandit::prior(int arm, qreal* mean, qreal* deviation)
+{
+	qreal sigma = noise();
+	if (Weights[arm - 1] > 0.05)
+	{
+		*mean = Sums[arm - 1] / Weights[arm - 1];
+		*deviation = sigma / sqrt(Weights[arm - 1]);
+		return;
+	}
+	*mean = 0;
+	*deviation = 0;
+	for (int distance = 1; distance < Weights.count(); distance++) // nearest measured neighbour
+	{
+		int near = (arm - distance >= 1 && Weights[arm - distance - 1] > 0.05) ? arm - distance : arm + distance;
+		if (near <= Weights.count() && Weights[near - 1] > 0.05)
+		{
+			*mean = Sums[near - 1] / Weights[near - 1];
+			*deviation = qMax(sigma, 0.25 * *mean);
+			return;
+		}
+	}
+}
+
+int ThreadBandit::choose(int limit)
+{
+	limit = qBound(1, limit, Weights.count());
+	qreal total = 0;
+	for (int i = 0; i < limit; i++) total += Weights[i];
+	int best = 1;
+	qreal best_score = -1;
+	for (int arm = 1; arm <= limit; arm++)
+	{
+		qreal mean = 0, deviation = 0, score = 0;
+		prior(arm, &mean, &deviation);
+		if (mean == 0 && deviation == 0) // nothing is measured yet
+			score = 0;
+		else if (Rule == ThompsonRule)
+			score = std::normal_distribution<qreal>(mean, qMax(deviation, 1e-9))(Generator);
+		else
+			score = mean + Exploration * deviation * sqrt(2 * log(qMax(total, 2.0)));
+		if (score > best_score) { best_score = score; best = arm; }
+	}
+	return best;
+}
+
+// TRACKING CONTROLLER CLASS - feedback loop holding a measured value at its target with the thread number (pid with anti-windup or aimd)
+
+class TrackingController
+{
+
+public:
+	enum TrackingRule { PidRule, AimdRule };
+
+	TrackingController() { start(1.0, 1, 1); }
+
+	void start(qreal target, int threads, int span, TrackingRule rule = PidRule, int direction = 1) // direction: +1 - the value grows with threads, -1 - falls
+	{
+		Target = target; Output = qMax(threads, 1); Span = qMax(span, 1); Rule = rule; Direction = (direction < 0) ? -1 : 1;
+		LastError = 0; LastDelta = 0; Samples = 0; Errors.clear();
+	}
+	void setGains(qreal kp, qreal ki, qreal kd) { Kp = kp; Ki = ki; Kd = kd; } // per unit of relative error, multiplied by the span
+	void setMaxStep(int step) { MaxStep = qMax(step, 1); } // max threads added or removed by one step
+	inline int step(qreal measured, qreal seconds, int threads, int limit); // returns the thread number for the next period (1..limit)
+	qreal getTarget() { return Target; }
+	qreal steadyError() { qreal sum = 0; foreach (qreal error, Errors) sum += error; return Errors.isEmpty() ? 0.0 : sum / Errors.count(); } // mean target - measured of the last samples
+	int samples() { return Samples; }
+
+private:
+	TrackingRule Rule;
+	qreal Target;
+	qreal Output; // continuous thread number of the pid rule (the clamped integrator)
+	int Span; // thread number a full relative error is worth (core budget)
+	int Direction;
+	qreal LastError = 0;
+	qreal LastDelta = 0; // error change of the last step
+
+	int Samples = 0;
+	QVector<qreal> Errors; // target - measured of the last STEADYDEPTH samples
+	qreal Kp = 0.05;
+	qreal Ki = 0.15; // per sec
+	qreal Kd = 0.0; // sec
+	int MaxStep = 4;
+	const qreal DeadBand = 0.05; // relative error the aimd rule doesn't react to
+	const qreal Decrease = 0.75; // aimd multiplicative decrease
+};
+
+int TrackingController::step(qreal measured, qreal seconds, int threads, int limit)
+{
+	Errors.append(Target - measured);
+	if (Errors.count() > STEADYDEPTH) Errors.remove(0);
+	qreal error = Direction * qBound(-1.0, (Target - measured) / qMax(fabs(Target), 1e-9), 1.0); // relative, > 0 - more threads needed
+	int low = qMax(1, threads - MaxStep), high = qMin(qMax(limit, 1), threads + MaxStep);
+	int next = threads;
+	if (Rule == AimdRule)
+	{
+		if (error > DeadBand) next = threads + qMax(1, (int)round(Span * error / 4)); // additive increase, bigger while far from the target
+		else if (error < -DeadBand) next = qMin(threads - 1, (int)floor(threads * Decrease));
+	}
+	else // velocity form: the output itself integrates, clamping it keeps the loop from winding up at the limits
+	{
+		if (fabs(Output - threads) >= 1) Output = threads; // the thread number was changed outside of the loop
+		qreal delta = error - LastError;
+		qreal derivative = (Samples > 0 && seconds > 0) ? Kd * Span * (delta - LastDelta) / seconds : 0;
+		Output += Kp * Span * delta + Ki * Span * error * seconds + derivative;
+		Output = qBound((qreal)low, Output, (qreal)high);
+		next = (int)round(Output);
+		LastDelta = delta;
+	}
+	LastError = error;
+	Samples++;
+	return qBound(low, next, high);
+}
+
+// OSCILLATION DETECTOR CLASS - limit cycles of any period in the thread number history, the throughput lost to them and exponential back-off (with jitter) of the next step of the cycle
+
+class OscillationDetector
+{
+
+public:
+	OscillationDetector(quint32 seed = 1) : Generator(seed) { clear(); }
+
+	void clear() { States.clear(); Dwells.clear(); Throughputs.clear(); Counted = 0; Quiet = 0; Period = 0; Direction = 0; Cycles = 0; Lost = 0; UpLevel = 0; DownLevel = 0; UpUntil = 0; DownUntil = 0; }
+	void setSeed(quint32 seed) { Generator.seed(seed); }
+	void setBackoff(qint64 base, qint64 max) { BaseLock = qMax(base, (qint64)1); MaxLock = qMax(max, BaseLock); } // ms of the first lock and the longest one
+	inline int add(int count, qreal dwell, qreal throughput, qint64 now); // thread number after a change, sec and tasks/sec at the one left, ms of the clock; returns the period of the cycle (0 - none)
+	bool isLocked(int direction, qint64 now) { return now < ((direction > 0) ? UpUntil : DownUntil); } // direction: +1 - adding threads, -1 - removing
+	qint64 lockLeft(int direction, qint64 now) { return qMax((qint64)0, ((direction > 0) ? UpUntil : DownUntil) - now); }
+	int level(int direction) { return (direction > 0) ? UpLevel : DownLevel; } // locks in a row of the direction
+	int period() { return Period; } // period of the last cycle (thread changes)
+	int direction() { return Direction; } // direction locked by the last cycle
+	int cycles() { return Cycles; } // cycles found since clear
+	qreal lost() { return Lost; } // tasks lost to the cycles against the best thread number of each cycle
+
+private:
+	QVector<int> States; // thread numbers after the changes
+	QVector<qreal> Dwells; // sec at each of them (0 for the current one)
+	QVector<qreal> Throughputs; // tasks/sec learned for each of them (0 if unknown)
+	int Counted; // states the lost throughput was counted for (cycles overlap)
+	int Quiet; // changes since the last cycle
+	int Period;
+	int Direction;
+	int Cycles;
+	qreal Lost;
+	int UpLevel;
+	int DownLevel;
+	qint64 UpUntil; // ms of the clock the up lock ends at
+	qint64 DownUntil;
+	qint64 BaseLock = 1000;
+	qint64 MaxLock = 32000;
+	const qreal Jitter = 0.25; // lock length varies +-25% (cycles of several controls don't stay in phase)
+	const int MaxLevel = 10;
+	std::mt19937 Generator;
+
+	inline int findPeriod(); // shortest period the last two cycles repeat with (0 - none)
+};
+
+int OscillationDetector::findPeriod()
+{
+	int n = States.count();
+	for (int period = 2; 2 * period + 1 <= n; period++)
+	{
+		bool repeats = true;
+		for (int k = 0; k <= period && repeats; k++)
+			repeats = (States[n - 1 - k] == States[n - 1 - k - period]);
+		if (repeats) return period;
+	}
+	return 0;
+}
+
+int OscillationDetector::add(int count, qreal dwell, qreal throughput, qint64 now)
+{
+	if (!States.isEmpty())
+	{
+		Dwells.last() = dwell;
+		Throughputs.last() = throughput;
+	}
+	States.append(count);
+	Dwells.append(0.0);
+	Throughputs.append(0.0);
+	if (States.count() > CYCLEDEPTH)
+	{
+		States.remove(0);
+		Dwells.remove(0);
+		Throughputs.remove(0);
+		Counted = qMax(Counted - 1, 0);
+	}
+	int period = findPeriod();
+	if (period == 0)
+	{
+		if (++Quiet > 2 * qMax(Period, 2)) { UpLevel = 0; DownLevel = 0; } // the control left the cycle for good -> back-off is forgiven
+		return 0;
+	}
+
+	// throughput lost on the states of the cycle not counted yet
+	int n = States.count();
+	qreal best = 0;
+	for (int i = n - 1 - period; i < n - 1; i++) best = qMax(best, Throughputs[i]);
+	for (int i = qMax(n - 1 - period, Counted); i < n - 1; i++)
+	{
+		if (Throughputs[i] > 0) Lost += (best - Throughputs[i]) * Dwells[i];
+	}
+	Counted = n - 1;
+	Quiet = 0;
+	Period = period;
+	Cycles++;
+
+	// locks the step the cycle takes next
+	Direction = (States[n - period] > count) ? 1 : -1;
+	int& level = (Direction > 0) ? UpLevel : DownLevel;
+	level = qMin(level + 1, MaxLevel);
+	qreal lock = qMin((qreal)MaxLock, BaseLock * pow(2.0, level - 1)) * (1 + Jitter * std::uniform_real_distribution<qreal>(-1.0, 1.0)(Generator));
+	((Direction > 0) ? UpUntil : DownUntil) = now + (qint64)lock;
+	return period;
+}
+
+#endif // CONTROLBASE_H
@@ -0,0 +1,190 @@
+#ifndef CONTROLBENCH_H
+#define CONTROLBENCH_H
+
+#include <qglobal.h>
+#include <qvector.h>
+#include <qmap.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qfile.h>
+#include <qtextstream.h>
+#include <qdebug.h>
+
+#define BENCH_ARGUMENT "--bench" // command line switch of the benchmark (optional seconds per run)
+#define BENCHFILE "ControlBench.csv" // results of the last benchmark (baseline of the next one)
+#define BENCHMODES 8 // modes of the load control every scenario is run with (light, hard, critical, usl, search, thompson, ucb, utilisation tracking)
+#define BENCHSECONDS 120 // default duration of every run
+#define BENCHSTEADY 0.33 // last share of the run the steady state is measured over
+#define BENCHSIM_ARGUMENT "--bench-sim" // command line switch of the simulated benchmark (optional virtual seconds per run and seed)
+#define BENCHSIMFILE "ControlBenchSim.csv" // results of the last simulated benchmark (baseline of the next one)
+#define BENCHSIMSECONDS 600 // default virtual duration of every simulated run
+
+// BENCH SCENARIO CLASS - scripted workload one run of the benchmark is made on
+
+class BenchScenario
+{
+
+public:
+	BenchScenario(QString name = QString(), int work = 0, int shift_work = -1, int noisy = 0)
+		: Name(name), Work(work), ShiftWork(shift_work), Noisy(noisy) {}
+
+	QString Name;
+	int Work; // ThreadTask::WorkType of the tasks
+	int ShiftWork; // work type the tasks switch to in the middle of the run (-1 - no shift)
+	int Noisy; // threads of the noisy neighbour started after the first third of the run (0 - none)
+
+	static inline QVector<BenchScenario> scenarios(int budget); // work types: 0 - cycle, 1 - memory, 3 - i/o
+};
+
+QVector<BenchScenario> BenchScenario::scenarios(int budget)
+{
+	QVector<BenchScenario> scenarios;
+	scenarios << BenchScenario("plateau", 0) // cpu bound: throughput flattens at the budget
+		<< BenchScenario("contention", 1) // memory bound: throughput peaks and falls
+		<< BenchScenario("io", 3) // blocking tasks: the best thread number is over the budget
+		<< BenchScenario("shift", 0, 1) // cpu bound turns memory bound
+		<< BenchScenario("noisy", 0, -1, qMax(budget / 2, 1)); // another process takes half of the cores
+	return scenarios;
+}
+
+
+// BENCH RESULT CLASS - what one mode did on one scenario
+
+class BenchResult
+{
+
+public:
+	QString Scenario;
+	QString Mode;
+	qreal Converge = -1; // sec till the thread number settled (-1 - never)
+	qreal Throughput = 0; // tasks/sec of the steady state
+	qreal Best = 0; // tasks/sec of the best window the run measured (candidate of the best mode)
+	qreal Churn = 0; // thread changes per minute
+	qreal Tail = 0; // p99 task time of the steady state (ms)
+	qreal Share = 0; // throughput share of the scenario oracle (%) - the best mode on real runs, where the true peak is unknown
+
+	QString toCsv() { return (QStringList() << Scenario << Mode << QString::number(Converge, 'f', 1) << QString::number(Throughput, 'f', 2) << QString::number(Best, 'f', 2)
+		<< QString::number(Churn, 'f', 2) << QString::number(Tail, 'f', 1) << QString::number(Share, 'f', 1)).join(","); }
+	inline bool fromCsv(QString line);
+	static QString csvHeader() { return "scenario,mode,converge_s,throughput,best,churn_per_min,p99_ms,share"; }
+};
+
+bool BenchResult::fromCsv(QString line)
+{
+	QStringList fields = line.split(",");
+	if (fields.count() < 8)
+		return false;
+	Scenario = fields[0];
+	Mode = fields[1];
+	Converge = fields[2].toDouble();
+	Throughput = fields[3].toDouble();
+	Best = fields[4].toDouble();
+	Churn = fields[5].toDouble();
+	Tail = fields[6].toDouble();
+	Share = fields[7].toDouble();
+	return true;
+}
+
+
+// BENCH TABLE CLASS - results of all modes on all scenarios (oracle of a scenario - its known true peak, else the best window any mode measured on it)
+
+class BenchTable
+{
+
+public:
+	void clear() { Results.clear(); Oracles.clear(); }
+	int count() { return Results.count(); }
+	BenchResult& at(int i) { return Results[i]; }
+	void setOracle(QString scenario, qreal throughput) { Oracles[scenario] = throughput; } // true peak tasks/sec of the scenario (the simulator knows it)
+	inline void add(BenchResult result); // updates the oracle shares of the scenario
+	inline QStringList table(); // comparison table (one line per run)
+	inline QStringList compare(BenchTable& baseline); // runs that got worse than the baseline (absolute throughput, p99 and convergence - a slowdown of every mode keeps the best mode shares)
+	inline bool save(QString path = BENCHFILE);
+	inline bool load(QString path = BENCHFILE);
+
+private:
+	QVector<BenchResult> Results;
+	QMap<QString, qreal> Oracles; // scenarios with a known true peak (the others are judged against the best mode)
+	const qreal ThroughputDrop = 0.05; // share of the baseline throughput lost treated as a regression
+	const qreal TailGrowth = 1.25; // p99 ratio treated as a regression
+	const qreal ConvergeGrowth = 1.5; // convergence time ratio treated as a regression
+};
+
+void BenchTable::add(BenchResult result)
+{
+	Results.append(result);
+	qreal best = Oracles.value(result.Scenario, 0);
+	for (int i = 0; i < Results.count() && !Oracles.contains(result.Scenario); i++)
+	{
+		if (Results[i].Scenario == result.Scenario) best = qMax(best, qMax(Results[i].Best, Results[i].Throughput));
+	}
+	for (int i = 0; i < Results.count(); i++)
+	{
+		if (Results[i].Scenario == result.Scenario) Results[i].Share = (best > 0) ? 100 * Results[i].Throughput / best : 0;
+	}
+}
+
+QStringList BenchTable::table()
+{
+	QStringList lines;
+	lines << QString("%1 %2 %3 %4 %5 %6 %7").arg("scenario", -11).arg("mode", -22).arg("converge s", 10).arg("tasks/sec", 10).arg(Oracles.isEmpty() ? "best mode %" : "oracle %", 11).arg("churn/min", 10).arg("p99 ms", 9);
+	foreach (BenchResult result, Results)
+	{
+		lines << QString("%1 %2 %3 %4 %5 %6 %7").arg(result.Scenario, -11).arg(result.Mode, -22)
+			.arg((result.Converge >= 0) ? QString::number(result.Converge, 'f', 1) : QString("-"), 10).arg(result.Throughput, 10, 'f', 2).arg(result.Share, 11, 'f', 1).arg(result.Churn, 10, 'f', 1).arg(result.Tail, 9, 'f', 1);
+	}
+	return lines;
+}
+
+QStringList BenchTable::compare(BenchTable& baseline)
+{
+	QStringList regressions;
+	foreach (BenchResult result, Results)
+	{
+		foreach (BenchResult base, baseline.Results)
+		{
+			if (base.Scenario != result.Scenario || base.Mode != result.Mode)
+				continue;
+			if (result.Throughput < base.Throughput * (1 - ThroughputDrop))
+				regressions << result.Scenario + " " + result.Mode + " - throughput " + QString::number(base.Throughput, 'f', 2) + " -> " + QString::number(result.Throughput, 'f', 2) + " tasks/sec";
+			if (base.Tail > 0 && result.Tail > base.Tail * TailGrowth)
+				regressions << result.Scenario + " " + result.Mode + " - p99 " + QString::number(base.Tail, 'f', 1) + " -> " + QString::number(result.Tail, 'f', 1) + " ms";
+			if (base.Converge >= 0 && (result.Converge < 0 || result.Converge > base.Converge * ConvergeGrowth))
+				regressions << result.Scenario + " " + result.Mode + " - convergence " + QString::number(base.Converge, 'f', 1) + " s -> "
+					+ ((result.Converge >= 0) ? QString::number(result.Converge, 'f', 1) + " s" : QString("never"));
+		}
+	}
+	return regressions;
+}
+
+bool BenchTable::save(QString path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+	{
+		qDebug() << "benchtable: unable to complete action | couldn't write" << path;
+		return false;
+	}
+	QTextStream stream(&file);
+	stream << BenchResult::csvHeader() << "\n";
+	foreach (BenchResult result, Results) stream << result.toCsv() << "\n";
+	return true;
+}
+
+bool BenchTable::load(QString path)
+{
+	Results.clear();
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return false;
+	QTextStream stream(&file);
+	QString line;
+	while (stream.readLineInto(&line))
+	{
+		BenchResult result;
+		if (!line.startsWith("scenario,") && result.fromCsv(line)) Results.append(result); // skips the header of older files too
+	}
+	return !Results.isEmpty();
+}
+
+#endif // CONTROLBENCH_H
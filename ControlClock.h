@@ -0,0 +1,48 @@
+#ifndef CONTROLCLOCK_H
+#define CONTROLCLOCK_H
+
+#include <qglobal.h>
+#include <qelapsedtimer.h>
+
+// CLOCK SOURCE CLASS - time the load control measures with (monotonic wall time, the simulator overrides it with its virtual time)
+
+class ClockSource
+{
+
+public:
+	ClockSource() { Timer.start(); }
+	virtual ~ClockSource() {}
+
+	virtual qint64 nsecs() { return Timer.nsecsElapsed(); } // ns since the clock was created
+	virtual bool isVirtual() { return false; } // virtual time doesn't run by itself (periodic work is driven by the owner of the clock)
+	virtual qint64 taskTime() { QElapsedTimer timer; timer.start(); return timer.msecsSinceReference(); } // ms on the clock of the task timestamps (TaskInfo::now())
+	qint64 msecs() { return nsecs() / 1000000; }
+	static ClockSource* system() { static ClockSource clock; return &clock; }
+
+private:
+	QElapsedTimer Timer;
+};
+
+
+// CLOCK TIMER CLASS - elapsed timer on a clock source (same use as QElapsedTimer)
+
+class ClockTimer
+{
+
+public:
+	ClockTimer(ClockSource* source = ClockSource::system()) : Source(source) {}
+
+	void setSource(ClockSource* source) { Source = source; Start = -1; } // the timer has to be started again
+	void start() { Start = Source->nsecs(); }
+	qint64 restart() { qint64 now = Source->nsecs(); qint64 ms = isValid() ? (now - Start) / 1000000 : 0; Start = now; return ms; }
+	qint64 nsecsElapsed() { return isValid() ? Source->nsecs() - Start : 0; }
+	qint64 elapsed() { return nsecsElapsed() / 1000000; }
+	bool isValid() { return Start >= 0; }
+	void invalidate() { Start = -1; }
+
+private:
+	ClockSource* Source;
+	qint64 Start = -1; // ns of the source at the start (-1 - not started)
+};
+
+#endif // CONTROLCLOCK_H
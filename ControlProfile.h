@@ -0,0 +1,143 @@
+#ifndef CONTROLPROFILE_H
+#define CONTROLPROFILE_H
+
+#include <qglobal.h>
+#include <qvector.h>
+#include <qpoint.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qfile.h>
+#include <qtextstream.h>
+#include <qsysinfo.h>
+#include <qdebug.h>
+
+#define PROFILEFILE "ControlProfiles.txt" // one line per host and workload
+
+// CONTROL PROFILE CLASS - what the load control learned about every thread number on one host and workload (warm start of the next run)
+
+class ControlProfile
+{
+
+public:
+	ControlProfile(QString key = QString()) : Key(key) {}
+
+	QString& getKey() { return Key; }
+	int& getMode() { return Mode; }
+	int& getBest() { return Best; }
+	QVector<QPointF>& getTimes() { return Times; } // time envelope of every thread number (x - lowest, y - highest allowed)
+	QVector<qreal>& getThroughputs() { return Throughputs; }
+	QVector<qreal>& getIpcs() { return Ipcs; }
+	int known() { int count = 0; foreach (QPointF time, Times) if (time.x() > 0) count++; return count; } // thread numbers with a measured envelope
+	static inline QString fingerprint(int budget, QString workload); // host, cpu model, core budget and workload name
+	static inline QString cpuModel();
+	inline bool save(QString path = PROFILEFILE); // replaces the line of the key (appends if there is none)
+	inline bool load(QString path = PROFILEFILE); // returns false if the file has no profile for the key
+
+private:
+	QString Key;
+	int Mode = 0; // system mode of the load control
+	int Best = 0; // thread number the control settled on
+	QVector<QPointF> Times;
+	QVector<qreal> Throughputs; // tasks/sec
+	QVector<qreal> Ipcs;
+
+	inline QString toLine();
+	inline bool fromLine(QString line);
+	static inline QStringList readLines(QString path);
+};
+
+QString ControlProfile::cpuModel()
+{
+	QFile file("/proc/cpuinfo");
+	if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		QTextStream stream(&file);
+		QString line;
+		while (stream.readLineInto(&line))
+		{
+			if (line.startsWith("model name"))
+				return line.section(':', 1).trimmed();
+		}
+	}
+	return QSysInfo::currentCpuArchitecture(); // no cpuinfo -> architecture only
+}
+
+QString ControlProfile::fingerprint(int budget, QString workload)
+{
+	QString key = QSysInfo::machineHostName() + "|" + cpuModel() + "|" + QString::number(budget) + "|" + workload;
+	return key.replace('\t', ' ').replace('\n', ' ');
+}
+
+QString ControlProfile::toLine()
+{
+	QStringList times, throughputs, ipcs;
+	foreach (QPointF time, Times) times << QString::number(time.x(), 'g', 6) + "," + QString::number(time.y(), 'g', 6);
+	foreach (qreal throughput, Throughputs) throughputs << QString::number(throughput, 'g', 6);
+	foreach (qreal ipc, Ipcs) ipcs << QString::number(ipc, 'g', 4);
+	return (QStringList() << Key << QString::number(Mode) << QString::number(Best) << times.join(' ') << throughputs.join(' ') << ipcs.join(' ')).join('\t');
+}
+
+bool ControlProfile::fromLine(QString line)
+{
+	QStringList fields = line.split('\t');
+	if (fields.count() < 6 || fields[0] != Key)
+		return false;
+	Mode = fields[1].toInt();
+	Best = fields[2].toInt();
+	Times.clear();
+	Throughputs.clear();
+	Ipcs.clear();
+	foreach (QString time, fields[3].split(' ', QString::SkipEmptyParts)) Times.append(QPointF(time.section(',', 0, 0).toDouble(), time.section(',', 1, 1).toDouble()));
+	foreach (QString throughput, fields[4].split(' ', QString::SkipEmptyParts)) Throughputs.append(throughput.toDouble());
+	foreach (QString ipc, fields[5].split(' ', QString::SkipEmptyParts)) Ipcs.append(ipc.toDouble());
+	return true;
+}
+
+QStringList ControlProfile::readLines(QString path)
+{
+	QStringList lines;
+	QFile file(path);
+	if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		QTextStream stream(&file);
+		QString line;
+		while (stream.readLineInto(&line))
+		{
+			if (!line.isEmpty()) lines.append(line);
+		}
+	}
+	return lines;
+}
+
+bool ControlProfile::load(QString path)
+{
+	foreach (QString line, readLines(path))
+	{
+		if (line.section('\t', 0, 0) == Key)
+			return fromLine(line);
+	}
+	return false;
+}
+
+bool ControlProfile::save(QString path)
+{
+	QStringList lines = readLines(path);
+	QString line = toLine();
+	bool replaced = false;
+	for (int i = 0; i < lines.count() && !replaced; i++)
+	{
+		if (lines[i].section('\t', 0, 0) == Key) { lines[i] = line; replaced = true; }
+	}
+	if (!replaced) lines.append(line);
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+	{
+		qDebug() << "controlprofile: unable to complete action | couldn't write" << path;
+		return false;
+	}
+	QTextStream stream(&file);
+	foreach (QString profile_line, lines) stream << profile_line << "\n";
+	return true;
+}
+
+#endif // CONTROLPROFILE_H
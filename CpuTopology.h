@@ -0,0 +1,273 @@
+#ifndef CPUTOPOLOGY_H
+#define CPUTOPOLOGY_H
+
+#include <qglobal.h>
+#include <qvector.h>
+#include <qstringlist.h>
+#include <qfile.h>
+#include <qmutex.h>
+#include <qthread.h>
+#include <qthreadstorage.h>
+#include <qdebug.h>
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+#define WORKBUFFER (4 * 1024 * 1024) // bytes of every worker's memory buffer
+
+// CPU TOPOLOGY CLASS - logical cpus of the affinity mask ordered for placement (node by node: physical cores first, then SMT siblings, grouped by shared L3)
+
+class CpuTopology
+{
+
+public:
+	struct CpuPlace
+	{
+		int Cpu = 0; // logical cpu number
+		int Core = 0; // first cpu of the thread siblings list (physical core key)
+		int Cache = 0; // index of the shared L3 group (package if no L3 found)
+		int Rank = 0; // 0 for the first allowed thread of a core, 1.. for SMT siblings
+		int Node = 0; // numa node (0 on machines without numa)
+	};
+
+	CpuTopology() { discover(); }
+
+	int count() { return Places.count(); }
+	CpuPlace& at(int slot) { return Places[slot]; } // place for the slot-th worker
+	int nodeCount() { return NodeCount; }
+	bool isSibling(int slot) { return slot >= 0 && slot < Places.count() && Places[slot].Rank > 0; }
+	bool isSpill(int slot) { return slot > 0 && slot < Places.count() && Places[slot].Node != Places[slot - 1].Node; } // first slot on the next node
+	inline QString getPlaceString(int slot); // short label of the place, f.e. "cpu5/L0" or "cpu13ht/L0"
+	static inline QVector<int> parseCpuList(QString list); // parses "0-3,8,10-11" lists of sysfs
+
+private:
+	QVector<CpuPlace> Places;
+	int NodeCount = 1;
+
+	inline void discover();
+	static inline QString readValue(QString path);
+};
+
+QVector<int> CpuTopology::parseCpuList(QString list)
+{
+	QVector<int> cpus;
+	foreach (QString range, list.trimmed().split(',', QString::SkipEmptyParts))
+	{
+		QStringList bounds = range.split('-');
+		int first = bounds[0].toInt();
+		int last = (bounds.count() > 1) ? bounds[1].toInt() : first;
+		for (int cpu = first; cpu <= last; cpu++) cpus.append(cpu);
+	}
+	return cpus;
+}
+
+QString CpuTopology::readValue(QString path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return QString();
+	return QString(file.readAll()).trimmed();
+}
+
+void CpuTopology::discover()
+{
+	QVector<int> cpus;
+#ifdef Q_OS_LINUX
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+	{
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			if (CPU_ISSET(cpu, &cpu_set)) cpus.append(cpu);
+	}
+#endif
+	if (cpus.isEmpty()) // no affinity mask -> flat topology
+	{
+		for (int cpu = 0; cpu < QThread::idealThreadCount(); cpu++) cpus.append(cpu);
+	}
+
+	// numa nodes (a single node if the kernel has no numa support)
+	QVector<int> nodes = parseCpuList(readValue("/sys/devices/system/node/online"));
+	QVector<int> node_of_cpu;
+	foreach (int node, nodes)
+	{
+		foreach (int cpu, parseCpuList(readValue(QString("/sys/devices/system/node/node%1/cpulist").arg(node))))
+		{
+			if (cpu >= node_of_cpu.count()) node_of_cpu.resize(cpu + 1);
+			node_of_cpu[cpu] = nodes.indexOf(node);
+		}
+	}
+	NodeCount = qMax(nodes.count(), 1);
+
+	QVector<int> caches; // first cpus of the L3 groups in order of appearance
+	QVector<CpuPlace> places;
+	foreach (int cpu, cpus)
+	{
+		QString cpu_path = QString("/sys/devices/system/cpu/cpu%1/").arg(cpu);
+		CpuPlace place;
+		place.Cpu = cpu;
+		place.Node = (cpu < node_of_cpu.count()) ? node_of_cpu[cpu] : 0;
+
+		// physical core and allowed siblings before this cpu
+		QVector<int> siblings = parseCpuList(readValue(cpu_path + "topology/thread_siblings_list"));
+		place.Core = siblings.isEmpty() ? cpu : siblings.first();
+		foreach (int sibling, siblings)
+			if (sibling < cpu && cpus.contains(sibling)) place.Rank++;
+
+		// shared last level cache group
+		int cache = -1;
+		for (int index = 0; index < 8; index++)
+		{
+			QString cache_path = cpu_path + QString("cache/index%1/").arg(index);
+			QString level = readValue(cache_path + "level");
+			if (level.isEmpty()) break;
+			if (level == "3")
+			{
+				QVector<int> shared = parseCpuList(readValue(cache_path + "shared_cpu_list"));
+				if (!shared.isEmpty()) cache = shared.first();
+			}
+		}
+		if (cache < 0) cache = -1 - readValue(cpu_path + "topology/physical_package_id").toInt(); // keys of packages don't mix with cpus
+		if (!caches.contains(cache)) caches.append(cache);
+		place.Cache = caches.indexOf(cache);
+		places.append(place);
+	}
+
+	// node by node: physical cores first, SMT siblings next; every phase is grouped by L3
+	Places.clear();
+	for (int node = 0; node < NodeCount; node++)
+	{
+		int node_places = 0;
+		foreach (CpuPlace place, places)
+			if (place.Node == node) node_places++;
+		for (int rank = 0; node_places > 0; rank++)
+		{
+			for (int cache = 0; cache < caches.count(); cache++)
+			{
+				foreach (CpuPlace place, places)
+					if (place.Node == node && place.Rank == rank && place.Cache == cache) { Places.append(place); node_places--; }
+			}
+		}
+	}
+	qDebug() << "cputopology: discovered |" << Places.count() << "cpus in" << caches.count() << "L3 groups on" << NodeCount << "nodes";
+}
+
+QString CpuTopology::getPlaceString(int slot)
+{
+	if (slot < 0 || slot >= Places.count())
+		return QString();
+	QString place = QString("cpu%1%2/L%3").arg(Places[slot].Cpu).arg(Places[slot].Rank > 0 ? "ht" : "").arg(Places[slot].Cache);
+	if (NodeCount > 1) place = QString("N%1/").arg(Places[slot].Node) + place;
+	return place;
+}
+
+
+// WORKER PLACEMENT CLASS - pins every running task's thread to the best free place of the topology
+
+class WorkerPlacement
+{
+
+public:
+	WorkerPlacement() : Enabled(false) { Busy.fill(false, Topology.count()); Buffers.fill(0, Topology.count()); }
+	~WorkerPlacement() { foreach (char* buffer, Buffers) delete[] buffer; }
+
+	CpuTopology& getTopology() { return Topology; }
+	void setEnabled(bool enabled) { QMutexLocker locker(&Mutex); Enabled = enabled; }
+	inline int claim(); // pins the calling thread to the best free place, returns its slot (-1 if disabled or no place is free)
+	inline void release(int slot);
+	inline char* buffer(int slot); // returns node local work buffer of the claimed slot (first touched by the pinned thread)
+	static inline char* threadBuffer(); // returns work buffer of the calling thread (for unpinned threads)
+
+private:
+	CpuTopology Topology;
+	QVector<bool> Busy; // slots taken by running tasks
+	QVector<char*> Buffers; // work buffers of the slots (allocated by the first thread pinned to the slot)
+	QMutex Mutex;
+	bool Enabled;
+
+	struct ThreadPlace { int Slot = -1; }; // last slot the thread was pinned to
+	static QThreadStorage<ThreadPlace*>& threadPlace() { static QThreadStorage<ThreadPlace*> storage; return storage; }
+	static inline bool pinThread(int cpu); // pins the calling thread to the cpu (-1 - unpins to the process mask)
+};
+
+bool WorkerPlacement::pinThread(int cpu)
+{
+#ifdef Q_OS_LINUX
+	static cpu_set_t process_set; // affinity mask the threads had before pinning
+	static bool process_set_saved = (sched_getaffinity(0, sizeof(process_set), &process_set) == 0);
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if (cpu >= 0) CPU_SET(cpu, &cpu_set);
+	else if (process_set_saved) cpu_set = process_set;
+	else return false;
+	return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0; // 0 - calling thread
+#else
+	Q_UNUSED(cpu);
+	return false;
+#endif
+}
+
+int WorkerPlacement::claim()
+{
+	if (!threadPlace().hasLocalData()) threadPlace().setLocalData(new ThreadPlace());
+	ThreadPlace* thread_place = threadPlace().localData();
+	int slot = -1;
+	{
+		QMutexLocker locker(&Mutex);
+		if (Enabled)
+		{
+			if (thread_place->Slot >= 0 && thread_place->Slot < Busy.count() && !Busy[thread_place->Slot]) // keep the previous place of the thread
+			{
+				slot = thread_place->Slot;
+			}
+			for (int i = 0; i < Busy.count() && slot < 0; i++)
+			{
+				if (!Busy[i]) slot = i;
+			}
+			if (slot >= 0) Busy[slot] = true;
+		}
+	}
+	if (slot != thread_place->Slot)
+	{
+		if (pinThread(slot >= 0 ? Topology.at(slot).Cpu : -1))
+		{
+			thread_place->Slot = slot;
+		}
+		else if (slot >= 0)
+		{
+			qDebug() << "workerplacement: unable to complete action | couldn't pin thread to" << Topology.getPlaceString(slot);
+		}
+	}
+	return slot;
+}
+
+char* WorkerPlacement::buffer(int slot)
+{
+	if (slot < 0 || slot >= Buffers.count())
+		return threadBuffer();
+	if (Buffers[slot] == 0) // the slot is claimed by the calling thread -> nobody else touches it now
+	{
+		char* buffer = new char[WORKBUFFER];
+		memset(buffer, 0, WORKBUFFER); // first touch from the pinned cpu places the pages on its node
+		Buffers[slot] = buffer;
+	}
+	return Buffers[slot];
+}
+
+char* WorkerPlacement::threadBuffer()
+{
+	struct ThreadBuffer { char* Data; ThreadBuffer() { Data = new char[WORKBUFFER]; memset(Data, 0, WORKBUFFER); } ~ThreadBuffer() { delete[] Data; } };
+	static QThreadStorage<ThreadBuffer*> storage;
+	if (!storage.hasLocalData()) storage.setLocalData(new ThreadBuffer());
+	return storage.localData()->Data;
+}
+
+void WorkerPlacement::release(int slot)
+{
+	QMutexLocker locker(&Mutex);
+	if (slot >= 0 && slot < Busy.count()) Busy[slot] = false;
+}
+
+#endif // CPUTOPOLOGY_H
@@ -0,0 +1,81 @@
+#ifndef NOISYNEIGHBOUR_H
+#define NOISYNEIGHBOUR_H
+
+#include <qobject.h>
+#include <qthread.h>
+#include <qprocess.h>
+#include <qelapsedtimer.h>
+#include <qcoreapplication.h>
+#include <qstringlist.h>
+#include <qdebug.h>
+
+#define NOISY_ARGUMENT "--noisy" // command line switch of the load generator process
+
+// NOISY THREAD CLASS - busy loop taking 'duty' percent of every 100 ms period
+
+class NoisyThread : public QThread
+{
+
+public:
+	NoisyThread(int duty) : Duty(qBound(1, duty, 100)) {}
+
+protected:
+	void run()
+	{
+		QElapsedTimer timer;
+		volatile quint64 counter = 0;
+		forever
+		{
+			timer.start();
+			while (timer.elapsed() < Duty) counter++; // busy part
+			if (Duty < 100) msleep(100 - Duty); // idle part
+		}
+	}
+
+private:
+	const int Duty; // percent of busy time
+};
+
+// NOISY NEIGHBOUR CLASS - separate process generating foreign cpu load on the host (for host load monitor testing)
+
+class NoisyNeighbour : public QObject
+{
+	Q_OBJECT
+
+public:
+	NoisyNeighbour(QObject* parent = 0) : QObject(parent) { Process = new QProcess(this); }
+	~NoisyNeighbour() { stop(); }
+
+	bool isRunning() { return Process->state() != QProcess::NotRunning; }
+	void start(int threads, int duty = 100) // starts the same executable in load generator mode
+	{
+		stop();
+		Process->start(QCoreApplication::applicationFilePath(), QStringList() << NOISY_ARGUMENT << QString::number(threads) << QString::number(duty));
+		qDebug() << "noisyneighbour: started |" << threads << "threads" << duty << "% duty";
+	}
+	void stop()
+	{
+		if (isRunning())
+		{
+			Process->kill();
+			Process->waitForFinished(1000);
+			qDebug() << "noisyneighbour: stopped";
+		}
+	}
+	static int run(int threads, int duty) // load generator mode (never returns until killed)
+	{
+		QList<NoisyThread*> noisy_threads;
+		for (int i = 0; i < qMax(threads, 1); i++)
+		{
+			noisy_threads.append(new NoisyThread(duty));
+			noisy_threads.last()->start();
+		}
+		foreach (NoisyThread* noisy_thread, noisy_threads) noisy_thread->wait();
+		return 0;
+	}
+
+private:
+	QProcess* Process;
+};
+
+#endif // NOISYNEIGHBOUR_H
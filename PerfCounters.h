@@ -0,0 +1,165 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <qglobal.h>
+#include <qdebug.h>
+
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+// PERF COUNTERS CLASS - per thread cycles/instructions/llc misses/context switches counters (perf_event_open)
+
+class PerfCounters
+{
+
+public:
+	enum CounterSource { NoCounters, SoftwareCounters, HardwareCounters };
+	enum CounterType { CyclesCounter, InstructionsCounter, MissesCounter, SwitchesCounter, CounterCount };
+
+	struct Sample
+	{
+		quint64 Cycles = 0;
+		quint64 Instructions = 0;
+		quint64 Misses = 0; // last level cache misses
+		quint64 Switches = 0; // voluntary + involuntary context switches
+	};
+
+	PerfCounters() : Source(NoCounters) { for (int i = 0; i < CounterCount; i++) Descriptors[i] = -1; }
+	~PerfCounters() { close(); }
+
+	inline CounterSource open(); // opens counters for the calling thread, returns the best available source
+	inline void close();
+	inline Sample read(); // returns current counter values of the calling thread
+	CounterSource getSource() { return Source; }
+	static inline CounterSource probe(); // checks which counters are available for this process
+	static inline QString getSourceString(CounterSource source);
+
+private:
+	CounterSource Source;
+	int Descriptors[CounterCount]; // perf event file descriptors (-1 if the counter isn't opened)
+
+	inline int openEvent(quint32 type, quint64 config, bool user_only);
+	inline quint64 readEvent(int descriptor);
+	inline quint64 readSwitches(); // software fallback for context switches
+};
+
+// PRIVATE METHODS
+
+int PerfCounters::openEvent(quint32 type, quint64 config, bool user_only)
+{
+#ifdef Q_OS_LINUX
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.exclude_kernel = user_only ? 1 : 0;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // calling thread on any cpu
+#else
+	Q_UNUSED(type); Q_UNUSED(config); Q_UNUSED(user_only);
+	return -1;
+#endif
+}
+
+quint64 PerfCounters::readEvent(int descriptor)
+{
+#ifdef Q_OS_LINUX
+	quint64 value = 0;
+	if (descriptor >= 0 && ::read(descriptor, &value, sizeof(value)) == sizeof(value))
+		return value;
+#else
+	Q_UNUSED(descriptor);
+#endif
+	return 0;
+}
+
+quint64 PerfCounters::readSwitches()
+{
+#ifdef Q_OS_LINUX
+	rusage usage;
+	if (getrusage(RUSAGE_THREAD, &usage) == 0)
+		return usage.ru_nvcsw + usage.ru_nivcsw;
+#endif
+	return 0;
+}
+
+// PUBLIC METHODS
+
+PerfCounters::CounterSource PerfCounters::open()
+{
+	close();
+#ifdef Q_OS_LINUX
+	Descriptors[CyclesCounter] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true);
+	Descriptors[InstructionsCounter] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true);
+	Descriptors[MissesCounter] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, true);
+	Descriptors[SwitchesCounter] = openEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false); // may be denied by perf_event_paranoid -> rusage
+	if (Descriptors[CyclesCounter] >= 0 && Descriptors[InstructionsCounter] >= 0)
+	{
+		Source = HardwareCounters;
+	}
+	else // no pmu (virtual machine) or access denied -> only software counters are left
+	{
+		for (int i = CyclesCounter; i <= MissesCounter; i++)
+		{
+			if (Descriptors[i] >= 0) { ::close(Descriptors[i]); Descriptors[i] = -1; }
+		}
+		Source = SoftwareCounters;
+	}
+#else
+	Source = NoCounters;
+#endif
+	return Source;
+}
+
+void PerfCounters::close()
+{
+#ifdef Q_OS_LINUX
+	for (int i = 0; i < CounterCount; i++)
+	{
+		if (Descriptors[i] >= 0) ::close(Descriptors[i]);
+	}
+#endif
+	for (int i = 0; i < CounterCount; i++) Descriptors[i] = -1;
+	Source = NoCounters;
+}
+
+PerfCounters::Sample PerfCounters::read()
+{
+	Sample sample;
+	if (Source == HardwareCounters)
+	{
+		sample.Cycles = readEvent(Descriptors[CyclesCounter]);
+		sample.Instructions = readEvent(Descriptors[InstructionsCounter]);
+		sample.Misses = readEvent(Descriptors[MissesCounter]);
+	}
+	if (Source != NoCounters)
+	{
+		sample.Switches = (Descriptors[SwitchesCounter] >= 0) ? readEvent(Descriptors[SwitchesCounter]) : readSwitches();
+	}
+	return sample;
+}
+
+PerfCounters::CounterSource PerfCounters::probe()
+{
+	PerfCounters counters;
+	return counters.open();
+}
+
+QString PerfCounters::getSourceString(CounterSource source)
+{
+	switch (source)
+	{
+	case HardwareCounters: return QString("hardware");
+	case SoftwareCounters: return QString("software");
+	default: return QString("unavailable");
+	}
+}
+
+#endif // PERFCOUNTERS_H
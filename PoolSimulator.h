@@ -0,0 +1,296 @@
+#ifndef POOLSIMULATOR_H
+#define POOLSIMULATOR_H
+
+#include <qglobal.h>
+#include <qobject.h>
+#include <qvector.h>
+#include <qdebug.h>
+#include <math.h>
+#include <queue>
+#include <random>
+#include <functional>
+#include "ThreadBase.h"
+#include "ControlClock.h"
+
+#define SIMSTEP 1000 // ms of virtual time between host samples (run queue delay, process load)
+
+// SIM CLOCK CLASS - virtual time of the simulator (stands still between the events)
+
+class SimClock : public ClockSource
+{
+
+public:
+	virtual qint64 nsecs() { return Now; }
+	virtual bool isVirtual() { return true; }
+	virtual qint64 taskTime() { return msecs(); } // simulated tasks are stamped with the virtual time
+	void setNsecs(qint64 ns) { Now = qMax(Now, ns); } // the time never runs back
+
+private:
+	qint64 Now = 0;
+};
+
+
+// SIM WORKLOAD CLASS - service time of the simulated tasks (lognormal cpu time slowed down by the usl contention, then a blocking wait)
+
+class SimWorkload
+{
+
+public:
+	SimWorkload(qreal cpu_ms = 20, qreal cv = 0.2, qreal sigma = 0, qreal kappa = 0, qreal io_ms = 0)
+		: CpuMs(cpu_ms), Cv(cv), Sigma(sigma), Kappa(kappa), IoMs(io_ms) {}
+
+	qreal CpuMs; // mean cpu time of a task alone on the host
+	qreal Cv; // coefficient of variation of the cpu and the blocking time
+	qreal Sigma; // usl contention (serialised share of the work)
+	qreal Kappa; // usl coherency (cost of every pair of running workers)
+	qreal IoMs; // mean time a task blocks off the cpu (0 - cpu bound)
+
+	qreal slowdown(qreal running) { return 1 + Sigma * (running - 1) + Kappa * running * (running - 1); } // cpu time growth with 'running' workers on the cpu
+	inline qreal throughput(int threads, int cores, int noisy = 0); // steady tasks/sec of 'threads' workers (mean value approximation of the simulator)
+	inline qreal peak(int limit, int cores, int noisy = 0); // best tasks/sec of any thread number up to 'limit' (oracle of the simulated benchmark)
+	static inline SimWorkload forWork(int work, int cores, qreal io_ms); // model of ThreadTask::WorkType 'work' (0 - cycle, 1 - memory, 3 - i/o)
+};
+
+qreal SimWorkload::throughput(int threads, int cores, int noisy)
+{
+	// the workers on the cpu share the cores with the noisy threads, the others block; the running number is solved by a fixed point
+	qreal running = threads;
+	qreal cycle = CpuMs;
+	for (int i = 0; i < 100; i++)
+	{
+		qreal speed = (running + noisy > cores) ? cores / (running + noisy) : 1.0;
+		qreal cpu = CpuMs * slowdown(qMax(running, 1.0)) / speed;
+		cycle = cpu + IoMs;
+		running = (running + threads * cpu / cycle) / 2; // damped (the step alone can swing around the fixed point)
+	}
+	return threads * 1000 / cycle;
+}
+
+qreal SimWorkload::peak(int limit, int cores, int noisy)
+{
+	qreal best = 0;
+	for (int threads = 1; threads <= limit; threads++) best = qMax(best, throughput(threads, cores, noisy));
+	return best;
+}
+
+SimWorkload SimWorkload::forWork(int work, int cores, qreal io_ms)
+{
+	qreal peak = qMax(cores * 0.75, 2.0); // memory bound tasks peak below the budget
+	switch (work)
+	{
+	case 1: return SimWorkload(20, 0.3, 0.05, 0.95 / (peak * peak));
+	case 3: return SimWorkload(10, 0.2, 0, 0, io_ms);
+	default: return SimWorkload(20, 0.2);
+	}
+}
+
+
+// SIM EVENT CLASS - task completion of a worker or a host sample at a point of the virtual time
+
+class SimEvent
+{
+
+public:
+	qint64 Time; // ns of the virtual clock
+	quint64 Order; // events of the same time are processed in the order they were scheduled (deterministic runs)
+	int Worker; // -1 - host sample
+
+	bool operator>(const SimEvent& other) const { return (Time != other.Time) ? Time > other.Time : Order > other.Order; }
+};
+
+
+// POOL SIMULATOR CLASS - discrete event model of the thread pool on a virtual clock (emits the signals of the task manager and the host monitors)
+
+class PoolSimulator : public QObject
+{
+	Q_OBJECT
+
+public:
+	PoolSimulator(SimClock* clock, int cores, int limit, quint32 seed = 1, QObject* parent = 0)
+		: QObject(parent), Clock(clock), Cores(qMax(cores, 1)), Limit(qMax(limit, 1)), Generator(seed) {}
+
+	void setWorkload(SimWorkload work) { Work = work; } // tasks started from now on
+	inline void setNoisy(int threads); // cpu bound threads of another process sharing the cores from now on
+	inline void start(int count);
+	inline void runUntil(qint64 ms); // processes the events till the virtual time (ms)
+	int getThreadCount() { return Threads; }
+	quint64 getTaskCount() { return Tasks; }
+
+public slots:
+	inline void addThread();
+	inline void removeThread(qreal ms = 0.0); // the worker retires after its current task
+
+signals:
+	void finishTime(int ms, int cpu_ms);
+	void finishInfo(TaskInfo task_info);
+	void threadCountChanged(int count, int transition); // workers after a change (+1 - added, -1 - removed)
+	void runQueueDelay(qreal ms, qreal delay); // run queue wait of the workers (ms per sec and average share per worker)
+	void processLoad(qreal own); // cores busy with the pool
+	void ceilingChanged(int ceiling); // cores the host can give the pool
+	void stepped(); // the virtual time moved (periodic work of the clock owners is due)
+
+private:
+	class SimWorker
+	{
+	public:
+		bool Alive = false;
+		bool Retiring = false;
+		qint64 Start = 0; // ns the current task started at
+		qint64 CpuEnd = 0; // ns the task leaves the cpu at
+		qint64 Cpu = 0; // ns of cpu time of the task
+	};
+
+	SimClock* Clock;
+	int Cores;
+	int Limit; // max workers
+	int Noisy = 0;
+	int Threads = 0; // workers not retiring
+	quint64 Tasks = 0;
+	quint64 Order = 0;
+	SimWorkload Work;
+	QVector<SimWorker> Workers;
+	std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> Events;
+	std::mt19937 Generator;
+
+	void schedule(qint64 time, int worker) { SimEvent event; event.Time = time; event.Order = Order++; event.Worker = worker; Events.push(event); }
+	inline qreal draw(qreal mean); // lognormal time with the mean and the cv of the workload
+	inline int running(); // workers in the cpu phase of their task
+	qreal speed(int running) { return (running + Noisy > Cores) ? (qreal)Cores / (running + Noisy) : 1.0; } // cpu share of a running worker (processor sharing)
+	inline void startTask(int worker);
+	inline void finishTask(int worker);
+	inline void sampleHost();
+};
+
+qreal PoolSimulator::draw(qreal mean)
+{
+	if (mean <= 0)
+		return 0.0;
+	if (Work.Cv <= 0)
+		return mean;
+	qreal s2 = log(1 + Work.Cv * Work.Cv);
+	std::lognormal_distribution<qreal> distribution(log(mean) - s2 / 2, sqrt(s2));
+	return distribution(Generator);
+}
+
+int PoolSimulator::running()
+{
+	int count = 0;
+	qint64 now = Clock->nsecs();
+	foreach (SimWorker worker, Workers) if (worker.Alive && worker.CpuEnd > now) count++;
+	return count;
+}
+
+void PoolSimulator::startTask(int worker)
+{
+	// the share of the cpu is fixed at the start of the task (processor sharing is approximated task by task)
+	qint64 now = Clock->nsecs();
+	int runners = running() + 1;
+	qreal cpu_ms = draw(Work.CpuMs) * Work.slowdown(runners);
+	SimWorker& current = Workers[worker];
+	current.Alive = true;
+	current.Start = now;
+	current.Cpu = (qint64)(cpu_ms * 1e6);
+	current.CpuEnd = now + (qint64)(cpu_ms / speed(runners) * 1e6);
+	schedule(current.CpuEnd + (qint64)(draw(Work.IoMs) * 1e6), worker);
+}
+
+void PoolSimulator::finishTask(int worker)
+{
+	qint64 now = Clock->nsecs();
+	TaskInfo task_info(0, "default", Workers[worker].Start / 1000000);
+	task_info.getFinishTime() = now / 1000000;
+	Tasks++;
+	emit finishInfo(task_info); // the finish time goes first (start of the decision latency)
+	emit finishTime((int)((now - Workers[worker].Start) / 1000000), (int)(Workers[worker].Cpu / 1000000));
+	if (Workers[worker].Retiring) // the control may have retired this worker on its own task
+	{
+		Workers[worker].Alive = false;
+		Workers[worker].Retiring = false;
+	}
+	else startTask(worker);
+}
+
+void PoolSimulator::sampleHost()
+{
+	int runners = running();
+	qreal wait = 1 - speed(runners);
+	emit runQueueDelay(wait * runners * 1000, wait);
+	emit processLoad(runners * speed(runners));
+	schedule(Clock->nsecs() + (qint64)SIMSTEP * 1000000, -1);
+}
+
+void PoolSimulator::setNoisy(int threads)
+{
+	Noisy = qMax(threads, 0);
+	emit ceilingChanged(qMax(Cores - Noisy, 1));
+	qDebug() << "poolsimulator: noisy load |" << Noisy << "threads";
+}
+
+void PoolSimulator::start(int count)
+{
+	Workers.clear();
+	Events = std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>>();
+	Threads = qBound(1, count, Limit);
+	Tasks = 0;
+	Workers.resize(Threads);
+	for (int i = 0; i < Threads; i++) startTask(i);
+	schedule(Clock->nsecs() + (qint64)SIMSTEP * 1000000, -1);
+	qDebug() << "poolsimulator: started |" << Threads << "workers on" << Cores << "cores";
+}
+
+void PoolSimulator::runUntil(qint64 ms)
+{
+	qint64 end = ms * 1000000;
+	while (!Events.empty() && Events.top().Time <= end)
+	{
+		SimEvent event = Events.top();
+		Events.pop();
+		Clock->setNsecs(event.Time);
+		if (event.Worker < 0) sampleHost();
+		else finishTask(event.Worker);
+		emit stepped();
+	}
+	Clock->setNsecs(end);
+	emit stepped();
+}
+
+void PoolSimulator::addThread()
+{
+	if (Threads >= Limit)
+		return;
+	Threads++;
+	int worker = -1;
+	for (int i = 0; i < Workers.count() && worker < 0; i++)
+	{
+		if (Workers[i].Alive && Workers[i].Retiring) { Workers[i].Retiring = false; worker = i; } // keeps the retiring one
+	}
+	for (int i = 0; i < Workers.count() && worker < 0; i++)
+	{
+		if (!Workers[i].Alive) { worker = i; startTask(i); }
+	}
+	if (worker < 0)
+	{
+		Workers.append(SimWorker());
+		startTask(Workers.count() - 1);
+	}
+	emit threadCountChanged(Threads, 1);
+}
+
+void PoolSimulator::removeThread(qreal ms)
+{
+	Q_UNUSED(ms);
+	if (Threads <= 1)
+		return;
+	for (int i = Workers.count() - 1; i >= 0; i--)
+	{
+		if (Workers[i].Alive && !Workers[i].Retiring)
+		{
+			Workers[i].Retiring = true;
+			break;
+		}
+	}
+	Threads--;
+	emit threadCountChanged(Threads, -1);
+}
+
+#endif // POOLSIMULATOR_H
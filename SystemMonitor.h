@@ -0,0 +1,346 @@
+#ifndef SYSTEMMONITOR_H
+#define SYSTEMMONITOR_H
+
+#include <qobject.h>
+#include <qtimer.h>
+#include <qfile.h>
+#include <qmap.h>
+#include <qelapsedtimer.h>
+#include <qdebug.h>
+#include <qthread.h>
+#include "ThreadBase.h"
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+// SCHEDSTAT SAMPLER CLASS - periodic reading of run queue wait time of every worker thread (/proc/self/task/<tid>/schedstat)
+
+class SchedStatSampler : public QObject
+{
+	Q_OBJECT
+
+public:
+	SchedStatSampler(int period = 500, QObject* parent = 0) : QObject(parent), SamplePeriod(period)
+	{
+		SampleTimer = new QTimer(this);
+		connect(SampleTimer, &QTimer::timeout, this, &SchedStatSampler::sample);
+	}
+
+	struct ThreadSample
+	{
+		quint64 RunTime = 0; // ns spent on cpu
+		quint64 WaitTime = 0; // ns spent runnable in the run queue
+	};
+
+	void start() { clear(); SampleClock.start(); SampleTimer->start(SamplePeriod); }
+	void stop() { SampleTimer->stop(); clear(); }
+	void clear() { ThreadBase.clear(); }
+	void addThread(qint64 tid) // registers a worker thread to sample
+	{
+		if (tid > 0 && !ThreadBase.contains(tid))
+		{
+			ThreadSample thread_sample;
+			if (readThread(tid, thread_sample)) ThreadBase.insert(tid, thread_sample);
+		}
+	}
+	static inline bool readThread(qint64 tid, ThreadSample& thread_sample); // returns false if the thread is gone or schedstat isn't available
+
+public slots:
+	void addFinishedTask(ThreadState thread_state) { addThread(thread_state.getTid()); }
+	inline void sample();
+
+private:
+	QMap<qint64, ThreadSample> ThreadBase; // last sample of every worker thread
+	QTimer* SampleTimer;
+	QElapsedTimer SampleClock; // measures the real sample interval
+	const int SamplePeriod; // ms
+
+signals:
+	void threadDelay(qint64 tid, qreal delay); // share of the interval the thread was waiting for a cpu
+	void totalDelay(qreal ms, qreal delay); // summary wait of all active workers (ms per sec) and its average share per worker
+};
+
+bool SchedStatSampler::readThread(qint64 tid, ThreadSample& thread_sample)
+{
+	QFile file(QString("/proc/self/task/%1/schedstat").arg(tid));
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return false;
+	QStringList values = QString(file.readAll()).split(' ', QString::SkipEmptyParts);
+	if (values.count() < 2)
+		return false;
+	thread_sample.RunTime = values[0].toULongLong();
+	thread_sample.WaitTime = values[1].toULongLong();
+	return true;
+}
+
+void SchedStatSampler::sample()
+{
+	qreal interval = SampleClock.restart() * 1000000.0; // ns
+	if (interval <= 0) return;
+	qreal total_wait = 0;
+	int active = 0;
+	QList<qint64> threads = ThreadBase.keys();
+	foreach (qint64 tid, threads)
+	{
+		ThreadSample thread_sample;
+		if (!readThread(tid, thread_sample)) // worker has exited
+		{
+			ThreadBase.remove(tid);
+			continue;
+		}
+		ThreadSample& last_sample = ThreadBase[tid];
+		quint64 run = thread_sample.RunTime - last_sample.RunTime;
+		quint64 wait = thread_sample.WaitTime - last_sample.WaitTime;
+		last_sample = thread_sample;
+		if (run + wait > 0) // idle workers of the pool don't take part in the statistics
+		{
+			emit threadDelay(tid, qMin(wait / interval, 1.0));
+			total_wait += wait;
+			active++;
+		}
+		else
+		{
+			emit threadDelay(tid, 0.0);
+		}
+	}
+	if (active > 0)
+		emit totalDelay(total_wait / interval * 1000, total_wait / interval / active);
+	else
+		emit totalDelay(0.0, 0.0);
+}
+
+
+// HOST LOAD MONITOR CLASS - periodic reading of host cpu idle time (/proc/stat) and pressure stall information (/proc/pressure)
+
+class HostLoadMonitor : public QObject
+{
+	Q_OBJECT
+
+public:
+	HostLoadMonitor(int budget, int period = 1000, QObject* parent = 0) : QObject(parent), CoreBudget(budget), SamplePeriod(period)
+	{
+		SampleTimer = new QTimer(this);
+		connect(SampleTimer, &QTimer::timeout, this, &HostLoadMonitor::sample);
+	}
+
+	struct CpuSample
+	{
+		quint64 Total = 0; // ticks of all cpus
+		quint64 Idle = 0; // idle + iowait ticks of all cpus
+		quint64 Own = 0; // user + system ticks of this process
+		int Cpus = 0; // number of online cpus
+	};
+
+	void start() { readCpu(LastSample); Ceiling = 0; RaiseCount = 0; SampleTimer->start(SamplePeriod); }
+	void stop() { SampleTimer->stop(); }
+	void setCoreBudget(int budget) { if (budget > 0) CoreBudget = budget; }
+	int getCeiling() { return Ceiling; }
+	static inline bool readCpu(CpuSample& cpu_sample); // returns false if /proc/stat isn't available
+	static inline qreal readPressure(QString resource, QString kind = "some"); // returns avg10 stall share (0..1) or -1 if psi isn't available
+
+public slots:
+	inline void sample();
+
+private:
+	QTimer* SampleTimer;
+	CpuSample LastSample;
+	int CoreBudget; // number of cores the process is allowed to use
+	int Ceiling = 0; // last reported thread ceiling (0 - not reported yet)
+	int RaiseCount = 0; // number of samples in a row that allow to raise the ceiling
+	const int SamplePeriod; // ms
+	const qreal CpuPressureLimit = 0.2; // cpu stall share of foreign threads above which one more core is taken off
+	const qreal MemoryPressureLimit = 0.05; // memory full stall share above which one more core is taken off
+	const int RaiseSamples = 3; // samples to wait for before raising the ceiling (falling is immediate)
+
+signals:
+	void hostLoad(qreal foreign, qreal cpu_pressure, qreal memory_pressure); // cores taken by other processes and psi stall shares
+	void processLoad(qreal own); // cores busy with this process
+	void ceilingChanged(int ceiling); // number of threads the host can give to the process now
+};
+
+bool HostLoadMonitor::readCpu(CpuSample& cpu_sample)
+{
+	QFile stat_file("/proc/stat");
+	if (!stat_file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return false;
+	cpu_sample.Cpus = 0;
+	while (!stat_file.atEnd())
+	{
+		QString line = QString(stat_file.readLine());
+		if (!line.startsWith("cpu")) break;
+		QStringList values = line.split(' ', QString::SkipEmptyParts);
+		if (values[0] == "cpu" && values.count() > 5) // user nice system idle iowait irq softirq steal ...
+		{
+			cpu_sample.Total = 0;
+			for (int i = 1; i < values.count() && i <= 8; i++) cpu_sample.Total += values[i].toULongLong();
+			cpu_sample.Idle = values[4].toULongLong() + values[5].toULongLong();
+		}
+		else
+		{
+			cpu_sample.Cpus++;
+		}
+	}
+	QFile self_file("/proc/self/stat");
+	if (self_file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		QString line = QString(self_file.readAll());
+		QStringList values = line.mid(line.lastIndexOf(')') + 2).split(' ', QString::SkipEmptyParts); // skip "pid (comm) "
+		if (values.count() > 12) cpu_sample.Own = values[11].toULongLong() + values[12].toULongLong(); // utime + stime
+	}
+	return cpu_sample.Cpus > 0;
+}
+
+qreal HostLoadMonitor::readPressure(QString resource, QString kind)
+{
+	QFile file("/proc/pressure/" + resource);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return -1.0;
+	while (!file.atEnd())
+	{
+		QStringList values = QString(file.readLine()).split(' ', QString::SkipEmptyParts);
+		if (values.count() > 1 && values[0] == kind && values[1].startsWith("avg10="))
+			return values[1].mid(6).toDouble() / 100;
+	}
+	return -1.0;
+}
+
+void HostLoadMonitor::sample()
+{
+	CpuSample cpu_sample;
+	if (!readCpu(cpu_sample) || cpu_sample.Total <= LastSample.Total)
+		return;
+	qreal total = cpu_sample.Total - LastSample.Total;
+	qreal busy = (total - (cpu_sample.Idle - LastSample.Idle)) / total * cpu_sample.Cpus; // busy cores of the host
+	qreal own = (cpu_sample.Own - LastSample.Own) / total * cpu_sample.Cpus; // busy cores of this process
+	qreal foreign = qMax(busy - own, 0.0);
+	LastSample = cpu_sample;
+
+	qreal cpu_pressure = readPressure("cpu");
+	qreal memory_pressure = readPressure("memory", "full");
+	emit hostLoad(foreign, cpu_pressure, memory_pressure);
+	emit processLoad(own);
+
+	// cores of the budget left by other processes
+	int ceiling = CoreBudget - qMax((int)round(foreign - (cpu_sample.Cpus - CoreBudget)), 0); // the budget may be a part of the host
+	if (cpu_pressure > CpuPressureLimit && foreign >= 0.5) ceiling--; // other runnable threads are stalled -> we take too much
+	if (memory_pressure > MemoryPressureLimit) ceiling--; // memory bound host -> more threads won't help
+	ceiling = qBound(1, ceiling, CoreBudget);
+
+	if (Ceiling == 0 || ceiling < Ceiling)
+	{
+		Ceiling = ceiling;
+		RaiseCount = 0;
+		emit ceilingChanged(Ceiling);
+	}
+	else if (ceiling > Ceiling)
+	{
+		if (++RaiseCount >= RaiseSamples) // cores are free for a while
+		{
+			Ceiling = ceiling;
+			RaiseCount = 0;
+			emit ceilingChanged(Ceiling);
+		}
+	}
+	else
+	{
+		RaiseCount = 0;
+	}
+}
+
+
+// CORE BUDGET MONITOR CLASS - number of cores the process may really use (affinity mask and cgroup v2 cpu.max quota)
+
+class CoreBudgetMonitor : public QObject
+{
+	Q_OBJECT
+
+public:
+	CoreBudgetMonitor(int period = 5000, QObject* parent = 0) : QObject(parent), SamplePeriod(period)
+	{
+		Budget = detect();
+		SampleTimer = new QTimer(this);
+		connect(SampleTimer, &QTimer::timeout, this, &CoreBudgetMonitor::sample);
+		SampleTimer->start(SamplePeriod);
+	}
+
+	int getBudget() { return Budget; }
+	static inline int detect(); // returns effective core budget (at least 1)
+	static inline int affinityCount(); // returns number of cpus in the affinity mask or 0 if unknown
+	static inline qreal quotaCount(); // returns cgroup cpu quota in cores or 0 if unlimited/unknown
+
+public slots:
+	void sample()
+	{
+		int budget = detect();
+		if (budget != Budget)
+		{
+			qDebug() << "corebudgetmonitor: budget changed |" << Budget << "->" << budget;
+			Budget = budget;
+			emit budgetChanged(Budget);
+		}
+	}
+
+private:
+	QTimer* SampleTimer;
+	int Budget;
+	const int SamplePeriod; // ms
+
+signals:
+	void budgetChanged(int budget);
+};
+
+int CoreBudgetMonitor::affinityCount()
+{
+#ifdef Q_OS_LINUX
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0)
+		return CPU_COUNT(&cpu_set);
+#endif
+	return 0;
+}
+
+qreal CoreBudgetMonitor::quotaCount()
+{
+	QFile cgroup_file("/proc/self/cgroup");
+	if (!cgroup_file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return 0.0;
+	QString cgroup_path;
+	while (!cgroup_file.atEnd())
+	{
+		QString line = QString(cgroup_file.readLine()).trimmed();
+		if (line.startsWith("0::")) { cgroup_path = line.mid(3); break; } // cgroup v2 unified hierarchy
+	}
+	if (cgroup_path.isEmpty())
+		return 0.0;
+
+	qreal quota = 0.0;
+	forever // the tightest limit along the path to the root is in force
+	{
+		QFile max_file("/sys/fs/cgroup" + cgroup_path + "/cpu.max");
+		if (max_file.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			QStringList values = QString(max_file.readAll()).split(' ', QString::SkipEmptyParts); // "max 100000" or "<quota> <period>"
+			if (values.count() == 2 && values[0] != "max" && values[1].toDouble() > 0)
+			{
+				qreal cores = values[0].toDouble() / values[1].toDouble();
+				if (quota == 0.0 || cores < quota) quota = cores;
+			}
+		}
+		if (cgroup_path.isEmpty() || cgroup_path == "/") break;
+		cgroup_path = cgroup_path.left(cgroup_path.lastIndexOf('/'));
+	}
+	return quota;
+}
+
+int CoreBudgetMonitor::detect()
+{
+	int budget = affinityCount();
+	if (budget <= 0) budget = QThread::idealThreadCount();
+	qreal quota = quotaCount();
+	if (quota > 0) budget = qMin(budget, (int)ceil(quota));
+	return qMax(budget, 1);
+}
+
+#endif // SYSTEMMONITOR_H
@@ -2,41 +2,200 @@
 #define THREADBASE_H
 
 #include <qthread.h>
+#include <qelapsedtimer.h>
 #include <qdebug.h>
 
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// SCHED POLICY CLASS - real scheduling class of a worker thread (policy, nice level, real time priority)
+
+class SchedPolicy
+{
+
+public:
+	enum PolicyType { UnknownPolicy, DefaultPolicy, BatchPolicy, IdlePolicy, FifoPolicy };
+
+	SchedPolicy(PolicyType type = UnknownPolicy, int nice = 0, int priority = 1) : Type(type), Nice(nice), Priority(priority) {}
+
+	PolicyType& getType() { return Type; }
+	int& getNice() { return Nice; }
+	int& getPriority() { return Priority; }
+	bool operator==(const SchedPolicy& value) const { return Type == value.Type && Nice == value.Nice && Priority == value.Priority; }
+	bool operator!=(const SchedPolicy& value) const { return !(*this == value); }
+
+	inline bool apply(); // applies the policy to the calling thread, returns false if the system doesn't allow it
+	static inline SchedPolicy current(); // reads the real policy of the calling thread
+	inline QString getString(); // short form, f.e. "N+5", "B", "I", "F10"
+
+private:
+	PolicyType Type;
+	int Nice; // -20..19 (SCHED_OTHER and SCHED_BATCH only)
+	int Priority; // 1..99 (SCHED_FIFO only)
+};
+
+bool SchedPolicy::apply()
+{
+#ifdef Q_OS_LINUX
+	sched_param param;
+	param.sched_priority = 0;
+	int policy = SCHED_OTHER;
+	switch (Type)
+	{
+	case DefaultPolicy: { policy = SCHED_OTHER; break; }
+	case BatchPolicy: { policy = SCHED_BATCH; break; }
+	case IdlePolicy: { policy = SCHED_IDLE; break; }
+	case FifoPolicy: { policy = SCHED_FIFO; param.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), Priority, sched_get_priority_max(SCHED_FIFO)); break; }
+	default: return false;
+	}
+	if (sched_setscheduler(0, policy, &param) != 0) // 0 - calling thread
+	{
+		qDebug() << "schedpolicy: access denied | couldn't set policy" << getString() << "errno" << errno;
+		return false;
+	}
+	if ((policy == SCHED_OTHER || policy == SCHED_BATCH) && setpriority(PRIO_PROCESS, syscall(SYS_gettid), Nice) != 0) // nice is per thread on linux
+	{
+		qDebug() << "schedpolicy: access denied | couldn't set nice" << Nice << "errno" << errno;
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+SchedPolicy SchedPolicy::current()
+{
+#ifdef Q_OS_LINUX
+	sched_param param;
+	int policy = sched_getscheduler(0);
+	sched_getparam(0, &param);
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, syscall(SYS_gettid));
+	if (errno != 0) nice = 0;
+	switch (policy)
+	{
+	case SCHED_OTHER: return SchedPolicy(DefaultPolicy, nice);
+	case SCHED_BATCH: return SchedPolicy(BatchPolicy, nice);
+	case SCHED_IDLE: return SchedPolicy(IdlePolicy);
+	case SCHED_FIFO: return SchedPolicy(FifoPolicy, 0, param.sched_priority);
+	default: return SchedPolicy(UnknownPolicy);
+	}
+#else
+	return SchedPolicy(UnknownPolicy);
+#endif
+}
+
+QString SchedPolicy::getString()
+{
+	QString nice_string = (Nice == 0) ? QString() : ((Nice > 0) ? "+" : "") + QString::number(Nice);
+	switch (Type)
+	{
+	case DefaultPolicy: return "N" + nice_string;
+	case BatchPolicy: return "B" + nice_string;
+	case IdlePolicy: return QString("I");
+	case FifoPolicy: return "F" + QString::number(Priority);
+	default: return QString("?");
+	}
+}
+
+// TASK INFO CLASS - workload class and queueing times of a single task (monotonic clock, ms)
+
+class TaskInfo
+{
+
+public:
+	TaskInfo(int class_id = 0, QString class_name = "default", qint64 enqueue = 0, qreal cost = 1.0)
+		: ClassId(class_id), ClassName(class_name), TaskCost(cost), EnqueueTime(enqueue), StartTime(enqueue), FinishTime(enqueue) {}
+
+	int& getClassId() { return ClassId; }
+	QString& getClassName() { return ClassName; }
+	qreal& getCost() { return TaskCost; }
+	qint64& getEnqueueTime() { return EnqueueTime; }
+	qint64& getStartTime() { return StartTime; }
+	qint64& getFinishTime() { return FinishTime; }
+	qint64& getDeadline() { return Deadline; }
+	bool hasDeadline() { return Deadline > 0; }
+	qint64 getQueueTime() { return StartTime - EnqueueTime; } // ms waiting in the class queue and the thread pool
+	qint64 getLatency() { return FinishTime - EnqueueTime; } // ms from enqueue to completion
+	qint64 getLateness() { return FinishTime - Deadline; } // ms after the deadline (negative - met with slack)
+	bool isMissed() { return hasDeadline() && FinishTime > Deadline; }
+	static qint64 now() { QElapsedTimer timer; timer.start(); return timer.msecsSinceReference(); } // same clock for all threads
+
+private:
+	int ClassId; // index of the class queue in task manager
+	QString ClassName;
+	qreal TaskCost; // work of the task relative to the standard task
+	qint64 EnqueueTime;
+	qint64 StartTime;
+	qint64 FinishTime;
+	qint64 Deadline = 0; // absolute time the task must finish by (0 - no deadline)
+};
+
 class ThreadState
 {
 
 public:
-	ThreadState(QString id = "0x0000", QThread* pointer = 0, qint32 time = 0, QThread::Priority priority = QThread::InheritPriority, quint32 limit = pow(2,32) - 1)
-			: ThreadName(id), ThreadPointer(pointer),ThreadTime(time), ThreadTasks(1), ThreadPriority(priority), ThreadTasksLimit(limit), IsKilled(false) {}
+	ThreadState(QString id = "0x0000", QThread* pointer = 0, qint32 time = 0, qint32 cpu_time = 0, QThread::Priority priority = QThread::InheritPriority, quint32 limit = pow(2,32) - 1)
+			: ThreadName(id), ThreadPointer(pointer),ThreadTime(time), ThreadCpuTime(cpu_time), ThreadTasks(1), ThreadPriority(priority), ThreadTasksLimit(limit), IsKilled(false) {}
 
 	qint32& getTime() { return ThreadTime; }
+	qint32& getCpuTime() { return ThreadCpuTime; }
 	quint32& getTasks() { return ThreadTasks; }
 	qreal getPerformance() { if (ThreadTime == 0) { return 0.0; } else { return (qreal)ThreadTasks * 1000 / ThreadTime; }} // return performance in tasks per second
+	qreal getCpuRatio() { if (ThreadTime == 0) { return 0.0; } else { return (qreal)ThreadCpuTime / ThreadTime; }} // returns cpu to wall time ratio (below 1 means the thread was descheduled or blocked)
+	qreal getIpc() { if (ThreadCycles == 0) { return 0.0; } else { return (qreal)ThreadInstructions / ThreadCycles; }} // returns instructions per cycle (0 if no hardware counters)
+	qreal getMissRate() { if (ThreadInstructions == 0) { return 0.0; } else { return (qreal)ThreadMisses * 1000 / ThreadInstructions; }} // returns llc misses per 1000 instructions
+	quint64& getSwitches() { return ThreadSwitches; }
+	bool hasCounters() { return ThreadCycles > 0; } // tells if hardware counters were read for this thread
 	inline qreal getPerformanceRound(uint precision); // returns performance in tasks per second with 'precision' decimal places
 	QThread::Priority& getPriority() { return ThreadPriority; }
 	QString& getName() { return ThreadName; }
 	QThread* getPointer() { return ThreadPointer; }
+	qint64 getTid() { return ThreadTid; } // kernel thread id (0 if unknown)
+	void setTid(qint64 tid) { ThreadTid = tid; }
+	QString& getPlace() { return ThreadPlace; } // cpu the thread is pinned to (empty if not pinned)
+	void setPlace(QString place) { ThreadPlace = place; }
+	SchedPolicy& getPolicy() { return ThreadPolicy; }
+	void setPolicy(SchedPolicy policy) { ThreadPolicy = policy; }
+	int getNode() { return ThreadNode; } // numa node of the pinned thread (-1 if not pinned)
+	void setNode(int node) { ThreadNode = node; }
 	bool& isKilled() { return IsKilled; }
 
 	inline ThreadState& operator+=(const ThreadState& value);
 
-	inline void addTask(int time);
+	inline void addTask(int time, int cpu_time);
 	//void replaceThread(QString id = "0x0000", QThread::Priority priority = QThread::InheritPriority) { ThreadName = id;  ThreadPriority = priority; }
 	void kill() { IsKilled = true; }
 	inline void setLimit(uint limit);
+	inline void setCounters(quint64 cycles, quint64 instructions, quint64 misses, quint64 switches);
 	inline QString getPriorityString();
 	inline void clear(); // kills threadstate and clears the task/time data
 
 private:
 	QString ThreadName;
 	QThread* ThreadPointer;
+	qint64 ThreadTid = 0;
+	QString ThreadPlace;
+	SchedPolicy ThreadPolicy; // real scheduling class (UnknownPolicy if not read)
+	int ThreadNode = -1;
 	QThread::Priority ThreadPriority;
 	qint32 ThreadTime; // ms
+	qint32 ThreadCpuTime; // ms, cpu time actually consumed by the thread during ThreadTime
+	quint64 ThreadCycles = 0; // hardware counters gathered during ThreadTime (0 if not available)
+	quint64 ThreadInstructions = 0;
+	quint64 ThreadMisses = 0;
+	quint64 ThreadSwitches = 0;
 	quint32 ThreadTasks; // count
 	quint32 ThreadTasksLimit; // max tasks capasity for this thread
 	bool IsKilled; // tells if the thread is killed by threadpool (when the threadstate is killed data modification is no longer available)
+
+	inline void compress(); // cuts tasks over the limit with their average share of the data (lossy compression)
 };
 
 ThreadState& ThreadState::operator+=(const ThreadState& value) // adds data (time & tasks) with rewriting ThreadName and ThreadPriority if needed
@@ -44,16 +203,19 @@ ThreadState& ThreadState::operator+=(const ThreadState& value) // adds data (tim
 	if (!this->IsKilled)
 	{
 		this->ThreadName = value.ThreadName;
+		this->ThreadTid = value.ThreadTid;
+		this->ThreadPlace = value.ThreadPlace;
+		this->ThreadPolicy = value.ThreadPolicy;
+		this->ThreadNode = value.ThreadNode;
 		this->ThreadPriority = value.ThreadPriority;
 		this->ThreadTime += value.ThreadTime;
+		this->ThreadCpuTime += value.ThreadCpuTime;
+		this->ThreadCycles += value.ThreadCycles;
+		this->ThreadInstructions += value.ThreadInstructions;
+		this->ThreadMisses += value.ThreadMisses;
+		this->ThreadSwitches += value.ThreadSwitches;
 		this->ThreadTasks += value.ThreadTasks;
-		if (this->ThreadTasks > this->ThreadTasksLimit) // overload -> lossy compression
-		{
-			quint32 diff = this->ThreadTasks - this->ThreadTasksLimit;
-			qreal avg = (qreal)this->ThreadTime / this->ThreadTasks;
-			this->ThreadTasks -= diff;
-			this->ThreadTime -= round(avg * diff);
-		}
+		compress();
 		return *this;
 	}
 	else
@@ -78,7 +240,7 @@ qreal ThreadState::getPerformanceRound(uint precision)
 	}
 }
 
-void ThreadState::addTask(int time)
+void ThreadState::addTask(int time, int cpu_time)
 {	
 	if (!this->IsKilled)
 	{
@@ -86,11 +248,12 @@ void ThreadState::addTask(int time)
 		{
 			if (ThreadTasks < ThreadTasksLimit) // below limit
 			{
-				ThreadTime += time; ThreadTasks++;
+				ThreadTime += time; ThreadCpuTime += cpu_time; ThreadTasks++;
 			}
 			else // above limit
 			{
 				ThreadTime = ThreadTime * ((qreal)(ThreadTasks - 1) / ThreadTasks) + time;
+				ThreadCpuTime = ThreadCpuTime * ((qreal)(ThreadTasks - 1) / ThreadTasks) + cpu_time;
 			}
 		}
 		else
@@ -109,13 +272,7 @@ void ThreadState::setLimit(quint32 limit)
 	if (!this->IsKilled)
 	{
 		ThreadTasksLimit = limit;
-		if (ThreadTasks > ThreadTasksLimit) // overload -> lossy compression
-		{
-			quint32 diff = ThreadTasks - ThreadTasksLimit;
-			qreal avg = (qreal)ThreadTime / ThreadTasks;
-			ThreadTasks -= diff;
-			ThreadTime -= round(avg * diff);
-		}
+		compress();
 	}
 	else
 	{
@@ -123,8 +280,41 @@ void ThreadState::setLimit(quint32 limit)
 	}
 }
 
+void ThreadState::setCounters(quint64 cycles, quint64 instructions, quint64 misses, quint64 switches)
+{
+	if (!this->IsKilled)
+	{
+		ThreadCycles = cycles;
+		ThreadInstructions = instructions;
+		ThreadMisses = misses;
+		ThreadSwitches = switches;
+	}
+	else
+	{
+		qDebug() << "threadstate: access denied | threadstate is killed";
+	}
+}
+
+void ThreadState::compress()
+{
+	if (ThreadTasks > ThreadTasksLimit) // overload -> lossy compression
+	{
+		quint32 diff = ThreadTasks - ThreadTasksLimit;
+		qreal share = (qreal)diff / ThreadTasks;
+		ThreadTime -= round(ThreadTime * share);
+		ThreadCpuTime -= round(ThreadCpuTime * share);
+		ThreadCycles -= round(ThreadCycles * share);
+		ThreadInstructions -= round(ThreadInstructions * share);
+		ThreadMisses -= round(ThreadMisses * share);
+		ThreadSwitches -= round(ThreadSwitches * share);
+		ThreadTasks -= diff;
+	}
+}
+
 QString ThreadState::getPriorityString()
 {
+	if (ThreadPolicy.getType() != SchedPolicy::UnknownPolicy) // real policy is known
+		return ThreadPolicy.getString();
 	QString priority_string;
 	switch (ThreadPriority)
 	{
@@ -141,6 +331,11 @@ void ThreadState::clear()
 {
 	IsKilled = true;
 	ThreadTime = 0;
+	ThreadCpuTime = 0;
+	ThreadCycles = 0;
+	ThreadInstructions = 0;
+	ThreadMisses = 0;
+	ThreadSwitches = 0;
 	ThreadTasks = 0;
 }
 
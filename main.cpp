@@ -4,9 +4,16 @@
 
 int main(int argc, char *argv[])
 {
+	if (argc > 3 && QString(argv[1]) == NOISY_ARGUMENT) // load generator process (noisy neighbour)
+		return NoisyNeighbour::run(QString(argv[2]).toInt(), QString(argv[3]).toInt());
+
 	QApplication a(argc, argv);
 	qApp->setStyle(QStyleFactory::create("Fusion"));
 	parallelsystem w;
 	w.show();
+	if (argc > 1 && QString(argv[1]) == BENCH_ARGUMENT) // benchmark of the load control modes (the table goes to the log and ControlBench.csv)
+		w.startBenchmark((argc > 2) ? QString(argv[2]).toInt() : BENCHSECONDS, true);
+	if (argc > 1 && QString(argv[1]) == BENCHSIM_ARGUMENT) // the same benchmark on the pool simulator (the table goes to the log and ControlBenchSim.csv)
+		w.startSimulation((argc > 2) ? QString(argv[2]).toInt() : BENCHSIMSECONDS, (argc > 3) ? QString(argv[3]).toUInt() : 1, true);
 	return a.exec();
 }
@@ -5,6 +5,7 @@ parallelsystem::parallelsystem(QWidget *parent)
 {
 	init();
 	qRegisterMetaType<ThreadState>("ThreadState");
+	qRegisterMetaType<TaskInfo>("TaskInfo");
 	// BUTTONS
 	connect(StartButton, &QPushButton::clicked, this, &parallelsystem::changeState);
 	connect(AddButton, &QPushButton::clicked, this, &parallelsystem::addThreadManual);
@@ -12,17 +13,54 @@ parallelsystem::parallelsystem(QWidget *parent)
 	// TASK MANAGER
 	connect(MyTaskManager, &TaskManager::finishTime, this, &parallelsystem::finishTask);
 	connect(MyTaskManager, &TaskManager::finishThread, BarThreadChart, &BarChartView::addFinishedTask);
+	connect(MyTaskManager, &TaskManager::finishCounters, System, &LoadControl::finishedCounters);
+	connect(MyTaskManager, &TaskManager::finishInfo, BarThreadChart, &BarChartView::addFinishedClassTask);
+	connect(MyTaskManager, &TaskManager::finishInfo, System, &LoadControl::finishedInfo);
+	connect(MyTaskManager, &TaskManager::finishInfo, this, &parallelsystem::finishInfo);
+	// SCHEDSTAT SAMPLER
+	connect(MyTaskManager, &TaskManager::finishThread, Sampler, &SchedStatSampler::addFinishedTask);
+	connect(Sampler, &SchedStatSampler::threadDelay, BarThreadChart, &BarChartView::setThreadDelay);
+	connect(Sampler, &SchedStatSampler::totalDelay, BarThreadChart, &BarChartView::setTotalDelay);
+	connect(Sampler, &SchedStatSampler::totalDelay, System, &LoadControl::setRunQueueDelay);
+	// HOST LOAD MONITOR
+	connect(HostMonitor, &HostLoadMonitor::ceilingChanged, this, &parallelsystem::changeCeiling);
+	connect(HostMonitor, &HostLoadMonitor::processLoad, System, &LoadControl::setProcessLoad);
+	connect(NoisyBox, &QCheckBox::stateChanged, this, &parallelsystem::changeNoisyState);
+	// CORE BUDGET MONITOR
+	connect(BudgetMonitor, &CoreBudgetMonitor::budgetChanged, this, &parallelsystem::changeBudget);
+	connect(System, &LoadControl::threadLimitChanged, this, &parallelsystem::changeLimit);
 	// LOAD SYSTEM
 	connect(System, &LoadControl::addThread, this, &parallelsystem::addThread);
 	connect(System, &LoadControl::removeThread, this, &parallelsystem::removeThread);
+	connect(System, &LoadControl::searchFinished, this, [this](int count, int probes) {
+		InfoEdit->append("#search " + QString::number(count) + " - " + QString::number(probes) + " probes"); });
+	connect(System, &LoadControl::converged, this, [this](qreal sec, int windows, qreal lost) {
+		InfoEdit->append("#converged " + System->getModeString() + " - " + QString::number(sec, 'f', 1) + " sec, " + QString::number(windows) + " windows, "
+			+ QString::number(lost, 'f', 0) + " tasks lost"); });
+	connect(System, &LoadControl::warmedUp, this, [this](int count, int tasks, qint64 ms) {
+		InfoEdit->append("#warm-up " + QString::number(count) + " - " + QString::number(tasks) + " tasks, " + QString::number(ms) + " ms"); });
+	connect(System, &LoadControl::workloadChanged, this, [this](QString shift) { InfoEdit->append("#workload change - " + shift + ", profile dropped"); });
+	connect(System, &LoadControl::converged, this, [this](qreal sec) { if (BenchIndex >= 0) BenchCurrent.Converge = sec; }); // the last one (a workload shift restarts it)
+	connect(System, &LoadControl::oscillated, this, [this](int period, int direction, qint64 ms, qreal lost) {
+		InfoEdit->append("#oscillation " + QString::number(period) + " - " + (direction > 0 ? "up" : "down") + " locked for " + QString::number(ms) + " ms, "
+			+ QString::number(lost, 'f', 0) + " tasks lost"); });
 	// SCALE CHART
 	connect(System, &LoadControl::timeDataChanged, StarScaleChart, &StarChartView::addScalePoint);
 	connect(StarScaleChart, &StarChartView::changedScalePoint, System, &LoadControl::setTimeData);
+	connect(System, &LoadControl::modelChanged, StarScaleChart, &StarChartView::setModel);
+	connect(System, &LoadControl::workloadChanged, StarScaleChart, &StarChartView::clearScale);
+	connect(System, &LoadControl::trackingSample, LoadChart, &LoadChartView::addTrackingPoint);
 	// BAR CHART + LOAD CHART
 	connect(LoadChart, &LoadChartView::updatePerformance, BarThreadChart, &BarChartView::makeOverallPerformance);
 	connect(BarThreadChart, &BarChartView::sendOverallPerformance, LoadChart, &LoadChartView::addPerformancePoint);
 	// SYSTEM CONTROL CHECK BOX
 	connect(SystemControlBox, &QCheckBox::stateChanged, this, &parallelsystem::changeSystemState);
+	// WORKERS CHECK BOXES
+	connect(CountersBox, &QCheckBox::stateChanged, this, &parallelsystem::changeCountersState);
+	connect(PinningBox, &QCheckBox::stateChanged, this, &parallelsystem::changePinningState);
+	connect(MemoryBox, &QCheckBox::stateChanged, this, &parallelsystem::changeMemoryState);
+	connect(BarThreadChart, &BarChartView::sendNodePerformance, LoadChart, &LoadChartView::addNodePerformancePoint);
+	connect(BarThreadChart, &BarChartView::sendClassPerformance, LoadChart, &LoadChartView::addClassPerformancePoint);
 }
 
 
@@ -38,7 +76,8 @@ void parallelsystem::init() // building the GUI
 	this->resize(QSize(500, 500));
 	this->setWindowTitle("Load System");
 
-	PerfectThreadCount = QThread::idealThreadCount();
+	BudgetMonitor = new CoreBudgetMonitor(5000, this);
+	PerfectThreadCount = BudgetMonitor->getBudget();
 
 	StartButton = new QPushButton(QString("Start"));
 	StartButton->setStyleSheet("font: 8pt Tahoma;");
@@ -55,13 +94,13 @@ void parallelsystem::init() // building the GUI
 	ThreadNumberBox = new QSpinBox();
 	ThreadNumberBox->setStyleSheet("font: bold 8pt Tahoma;");
 	ThreadNumberBox->setAlignment(Qt::AlignCenter);
-	ThreadNumberBox->setRange(1, PerfectThreadCount + OVERLOAD);
+	ThreadNumberBox->setRange(1, PerfectThreadCount * OVERSUBSCRIPTION);
 
-	LoadChart = new LoadChartView(PerfectThreadCount + OVERLOAD, this);
+	LoadChart = new LoadChartView(PerfectThreadCount, this);
 
-	StarScaleChart = new StarChartView(PerfectThreadCount + OVERLOAD, this);
+	StarScaleChart = new StarChartView(PerfectThreadCount * OVERSUBSCRIPTION, this);
 
-	BarThreadChart = new BarChartView(this, PerfectThreadCount + OVERLOAD);
+	BarThreadChart = new BarChartView(this, PerfectThreadCount * OVERSUBSCRIPTION);
 
 	// creating a new separate window for star scale chart
 
@@ -89,12 +128,89 @@ void parallelsystem::init() // building the GUI
 	SystemControlBox->setStyleSheet("spacing: 8px; font: bold 7pt Tahoma;");
 	SystemControlBox->setChecked(true);
 
+	NoisyBox = new QCheckBox("Noisy Load", this);
+	NoisyBox->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+	NoisyBox->setMaximumSize(QSize(200, 50));
+	NoisyBox->setStyleSheet("spacing: 8px; font: bold 7pt Tahoma;");
+	NoisyBox->setChecked(false);
+
+	// creating workers check boxes
+
+	CountersBox = new QCheckBox("Perf Counters", this);
+	CountersBox->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+	CountersBox->setMaximumSize(QSize(200, 50));
+	CountersBox->setStyleSheet("spacing: 8px; font: bold 7pt Tahoma;");
+	CountersBox->setChecked(false);
+
+	PinningBox = new QCheckBox("Pinning", this);
+	PinningBox->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+	PinningBox->setMaximumSize(QSize(200, 50));
+	PinningBox->setStyleSheet("spacing: 8px; font: bold 7pt Tahoma;");
+	PinningBox->setChecked(false);
+
+	MemoryBox = new QCheckBox("Memory Work", this);
+	MemoryBox->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+	MemoryBox->setMaximumSize(QSize(200, 50));
+	MemoryBox->setStyleSheet("spacing: 8px; font: bold 7pt Tahoma;");
+	MemoryBox->setChecked(false);
+
+	PolicyHelpMenu = new QMenu(this);
+	PolicyHelpMenu->addAction("Default", this, [this]() { setSchedPolicy(SchedPolicy(SchedPolicy::DefaultPolicy)); });
+	PolicyHelpMenu->addAction("Default Nice +5", this, [this]() { setSchedPolicy(SchedPolicy(SchedPolicy::DefaultPolicy, 5)); });
+	PolicyHelpMenu->addAction("Batch", this, [this]() { setSchedPolicy(SchedPolicy(SchedPolicy::BatchPolicy)); });
+	PolicyHelpMenu->addAction("Batch Nice +10", this, [this]() { setSchedPolicy(SchedPolicy(SchedPolicy::BatchPolicy, 10)); });
+	PolicyHelpMenu->addAction("Idle", this, [this]() { setSchedPolicy(SchedPolicy(SchedPolicy::IdlePolicy)); });
+	PolicyHelpMenu->addAction("FIFO", this, [this]() { setSchedPolicy(SchedPolicy(SchedPolicy::FifoPolicy, 0, 10)); });
+
+	PolicyButton = new QPushButton(QString("Policy"));
+	PolicyButton->setStyleSheet("font: 7pt Tahoma;");
+	PolicyButton->setMenu(PolicyHelpMenu);
+
+	ClassHelpMenu = new QMenu(this);
+	ClassHelpMenu->addAction("Single Class", this, [this]() { setTaskQueues(QList<TaskQueue>() << TaskQueue()); });
+	ClassHelpMenu->addAction("Interactive 1 : Batch 3", this, [this]() {
+		setTaskQueues(QList<TaskQueue>() << TaskQueue("interactive", 1, SEARCH_RANGE / 2) << TaskQueue("batch", 3, SEARCH_RANGE)); });
+	ClassHelpMenu->addAction("Interactive 1 : Batch 1", this, [this]() {
+		setTaskQueues(QList<TaskQueue>() << TaskQueue("interactive", 1, SEARCH_RANGE / 2) << TaskQueue("batch", 1, SEARCH_RANGE)); });
+	ClassHelpMenu->addAction("Interactive 100 ms : Batch 1000 ms", this, [this]() {
+		setTaskQueues(QList<TaskQueue>() << TaskQueue("interactive", 1, SEARCH_RANGE / 2, 100) << TaskQueue("batch", 3, SEARCH_RANGE, 1000)); });
+	ClassHelpMenu->addSeparator();
+	ClassHelpMenu->addAction("Fair Dispatch", this, [this]() { setDispatchMode(TaskManager::FairDispatch); });
+	ClassHelpMenu->addAction("EDF Dispatch", this, [this]() { setDispatchMode(TaskManager::DeadlineDispatch); });
+
+	ClassButton = new QPushButton(QString("Classes"));
+	ClassButton->setStyleSheet("font: 7pt Tahoma;");
+	ClassButton->setMenu(ClassHelpMenu);
+
 	// creating system help menu
 
 	SystemHelpMenu = new QMenu(this);
 	SystemHelpMenu->addAction("Light Mode", this, &parallelsystem::setSystemLightMode);
 	SystemHelpMenu->addAction("Hard Mode", this, &parallelsystem::setSystemHardMode);
 	SystemHelpMenu->addAction("Critical Mode", this, &parallelsystem::setSystemCriticalMode);
+	SystemHelpMenu->addAction("USL Mode", this, &parallelsystem::setSystemUslMode);
+	SystemHelpMenu->addAction("Search Mode", this, &parallelsystem::setSystemSearchMode);
+	SystemHelpMenu->addAction("Bandit Mode", this, [this]() { setSystemBanditMode(ThreadBandit::ThompsonRule); });
+	SystemHelpMenu->addAction("UCB Bandit Mode", this, [this]() { setSystemBanditMode(ThreadBandit::UcbRule); });
+	SystemHelpMenu->addAction("Deadline Mode", this, &parallelsystem::setSystemDeadlineMode);
+	SystemHelpMenu->addAction("SLO Mode", this, &parallelsystem::setSystemSloMode);
+	SystemHelpMenu->addAction("Utilisation Tracking Mode", this, [this]() { setSystemTrackingMode(LoadControl::UtilisationTrack); });
+	SystemHelpMenu->addAction("Run Queue Tracking Mode", this, [this]() { setSystemTrackingMode(LoadControl::RunQueueTrack); });
+	SystemHelpMenu->addAction("Queue Wait Tracking Mode", this, [this]() { setSystemTrackingMode(LoadControl::QueueWaitTrack); });
+	SystemHelpMenu->addSeparator();
+	WarmStartAction = SystemHelpMenu->addAction("Warm Start");
+	WarmStartAction->setCheckable(true);
+	WarmStartAction->setChecked(true);
+	SystemHelpMenu->addAction("Decision Log", this, &parallelsystem::showDecisionLog);
+	SystemHelpMenu->addAction("Benchmark", this, [this]() {
+		bool ok = false;
+		int runs = BenchScenario::scenarios(PerfectThreadCount).count() * BENCHMODES;
+		int seconds = QInputDialog::getInt(this, "Benchmark", QString::number(runs) + " runs (every mode on every scenario), sec per run:", BENCHSECONDS, 30, 3600, 10, &ok);
+		if (ok) startBenchmark(seconds); });
+	SystemHelpMenu->addAction("Simulated Benchmark", this, [this]() {
+		bool ok = false;
+		int seconds = QInputDialog::getInt(this, "Simulated Benchmark", "Virtual sec per run (every mode on every scenario):", BENCHSIMSECONDS, 30, 36000, 60, &ok);
+		if (ok) startSimulation(seconds); });
 
 	// PALETTE SETTINGS
 	
@@ -126,8 +242,17 @@ void parallelsystem::init() // building the GUI
 
 	QHBoxLayout *systemboxlayout = new QHBoxLayout(this);
 	systemboxlayout->addWidget(SystemControlBox);
+	systemboxlayout->addWidget(NoisyBox);
 	systemboxlayout->setMargin(0);
 
+	QHBoxLayout *workerboxlayout = new QHBoxLayout(this);
+	workerboxlayout->addWidget(CountersBox);
+	workerboxlayout->addWidget(PinningBox);
+	workerboxlayout->addWidget(MemoryBox);
+	workerboxlayout->addWidget(PolicyButton);
+	workerboxlayout->addWidget(ClassButton);
+	workerboxlayout->setMargin(0);
+
 	QGroupBox *chartgroup = new QGroupBox("Charts", this);
 	chartgroup->setLayout(chartboxlayout);
 	chartgroup->setCheckable(true);
@@ -140,9 +265,16 @@ void parallelsystem::init() // building the GUI
 	systemgroup->setChecked(false);
 	systemgroup->setContentsMargins(10, 25, 10, 5);
 
+	QGroupBox *workergroup = new QGroupBox("Workers", this);
+	workergroup->setLayout(workerboxlayout);
+	workergroup->setCheckable(true);
+	workergroup->setChecked(false);
+	workergroup->setContentsMargins(10, 25, 10, 5);
+
 	QVBoxLayout *checkboxgrouplayout = new QVBoxLayout(this);
 	checkboxgrouplayout->addWidget(chartgroup);
 	checkboxgrouplayout->addWidget(systemgroup);
+	checkboxgrouplayout->addWidget(workergroup);
 	checkboxgrouplayout->setMargin(0);
 	
 	QHBoxLayout *tophlayout = new QHBoxLayout(this);
@@ -176,6 +308,12 @@ void parallelsystem::init() // building the GUI
 
 	System = new LoadControl(PerfectThreadCount);
 
+	Sampler = new SchedStatSampler(500, this);
+
+	HostMonitor = new HostLoadMonitor(PerfectThreadCount, 1000, this);
+
+	Noisy = new NoisyNeighbour(this);
+
 	IsRunning = false;
 
 
@@ -198,6 +336,7 @@ void parallelsystem::startThreads()
 	RemoveButton->setEnabled(true);
 	ThreadNumberBox->setEnabled(false);
 	StartButton->setText("Stop");
+	if (SystemControlBox->isChecked()) warmStart();
 	InfoEdit->append("#start " + QString::number(ThreadNumberBox->value()));
 	if (SystemControlBox->isChecked())
 	{
@@ -205,6 +344,11 @@ void parallelsystem::startThreads()
 		System->start(ThreadNumberBox->value());
 	}
 	MyTaskManager->startThreads(ThreadNumberBox->value());
+	Sampler->start();
+	HostMonitor->start();
+	PolicyHistogram.clear();
+	PolicyClock.start();
+	DeadlineMeters.clear();
 	LoadChart->addPerformancePoint(0.0);
 	LoadChart->addLoadPoint(ThreadNumberBox->value());
 	LoadChart->setPerformanceAxisCalibrated(0);
@@ -224,7 +368,15 @@ void parallelsystem::stopThreads()
 	StartButton->setText("Start");
 	InfoEdit->append("#stop");
 	if (SystemControlBox->isChecked()) InfoEdit->append("#system switches off");
+	reportSchedPolicy();
+	reportDeadlines();
+	reportSlo();
+	reportRegret();
+	reportTracking();
 	MyTaskManager->stopThreads();
+	Sampler->stop();
+	HostMonitor->stop();
+	if (SystemControlBox->isChecked()) saveProfile();
 	System->finish();
 	LoadChart->addLoadPoint(0);
 }
@@ -232,6 +384,7 @@ void parallelsystem::stopThreads()
 
 void parallelsystem::changeState()
 {
+	if (BenchIndex >= 0) stopBenchmark(); // stopped by hand
 	if (IsRunning == true)
 	{
 		IsRunning = false;
@@ -262,14 +415,553 @@ void parallelsystem::changeSystemState(int state)
 }
 
 
+void parallelsystem::changeCountersState(int state)
+{
+	MyTaskManager->setCountersEnabled(state == Qt::Checked);
+	if (state == Qt::Checked)
+		InfoEdit->append("#counters switch on - " + PerfCounters::getSourceString(PerfCounters::probe()));
+	else if (state == Qt::Unchecked)
+		InfoEdit->append("#counters switch off");
+}
+
+
+void parallelsystem::changePinningState(int state)
+{
+	MyTaskManager->setPlacementEnabled(state == Qt::Checked);
+	if (state == Qt::Checked)
+	{
+		CpuTopology& topology = MyTaskManager->getPlacement().getTopology();
+		QVector<LoadControl::PlaceKind> plan;
+		for (int i = 0; i < topology.count(); i++)
+		{
+			if (topology.isSpill(i)) plan.append(LoadControl::SpillPlace);
+			else if (topology.isSibling(i)) plan.append(LoadControl::SiblingPlace);
+			else plan.append(LoadControl::CorePlace);
+		}
+		System->setPlacementPlan(plan);
+		InfoEdit->append("#pinning on - " + QString::number(topology.count()) + " cpus, " + QString::number(topology.nodeCount()) + " nodes");
+	}
+	else if (state == Qt::Unchecked)
+	{
+		System->setPlacementPlan(QVector<LoadControl::PlaceKind>());
+		InfoEdit->append("#pinning off");
+	}
+}
+
+
+void parallelsystem::changeMemoryState(int state)
+{
+	MyTaskManager->setWorkType(state == Qt::Checked ? ThreadTask::MemoryWork : ThreadTask::CycleWork);
+	if (state == Qt::Checked)
+		InfoEdit->append("#work - memory");
+	else if (state == Qt::Unchecked)
+		InfoEdit->append("#work - cycle");
+}
+
+
+void parallelsystem::setSchedPolicy(SchedPolicy policy)
+{
+	if (IsRunning) reportSchedPolicy();
+	CurrentPolicy = policy;
+	MyTaskManager->setSchedPolicy(policy);
+	PolicyButton->setText("Policy " + policy.getString());
+	InfoEdit->append("#policy " + policy.getString());
+	PolicyHistogram.clear();
+	PolicyClock.start();
+}
+
+
+void parallelsystem::setTaskQueues(QList<TaskQueue> queues)
+{
+	if (IsRunning) reportDeadlines();
+	DeadlineMeters.clear();
+	MyTaskManager->setTaskQueues(queues);
+	BarThreadChart->clearClassBase();
+	QString classes;
+	for (int i = 0; i < queues.count(); i++)
+	{
+		classes += " " + queues[i].getName() + ":" + QString::number(queues[i].getWeight());
+		if (queues[i].getDeadline() > 0) classes += "/" + QString::number(queues[i].getDeadline()) + "ms";
+	}
+	ClassButton->setText("Classes " + QString::number(queues.count()));
+	InfoEdit->append("#classes" + classes);
+}
+
+
+void parallelsystem::setDispatchMode(TaskManager::DispatchMode mode)
+{
+	MyTaskManager->setDispatchMode(mode);
+	InfoEdit->append(mode == TaskManager::DeadlineDispatch ? "#dispatch - edf" : "#dispatch - fair");
+}
+
+
+void parallelsystem::finishInfo(TaskInfo task_info)
+{
+	if (task_info.hasDeadline())
+	{
+		while (DeadlineMeters.count() <= task_info.getClassId()) DeadlineMeters.append(DeadlineMeter());
+		DeadlineMeters[task_info.getClassId()].add(task_info.getLateness());
+	}
+}
+
+
+void parallelsystem::reportDeadlines()
+{
+	QList<TaskQueue>& queues = MyTaskManager->getTaskQueues();
+	for (int i = 0; i < DeadlineMeters.count() && i < queues.count(); i++)
+	{
+		DeadlineMeter& meter = DeadlineMeters[i];
+		if (meter.count() > 0)
+		{
+			InfoEdit->append("#deadline " + queues[i].getName() + " - miss " + QString::number(meter.missRate() * 100, 'f', 1) + "% of " + QString::number(meter.count())
+				+ ", lateness p50 " + QString::number(meter.lateness().percentile(0.5), 'f', 1) + " ms, p99 " + QString::number(meter.lateness().percentile(0.99), 'f', 1)
+				+ " ms, max " + QString::number(meter.lateness().max(), 'f', 1) + " ms");
+		}
+	}
+}
+
+
+void parallelsystem::setSystemSloMode()
+{
+	bool ok = false;
+	QStringList metrics = QStringList() << "p99 completion" << "p99 queueing";
+	QString metric = QInputDialog::getItem(this, "SLO Mode", "Target metric:", metrics, (System->getSloMetric() == LoadControl::QueueSlo) ? 1 : 0, false, &ok);
+	if (!ok) return;
+	qreal target = QInputDialog::getDouble(this, "SLO Mode", "Target, ms:", System->getSloTarget(), 1.0, 60000.0, 1, &ok);
+	if (!ok) return;
+	System->setSloTarget(target, (metric == metrics[1]) ? LoadControl::QueueSlo : LoadControl::CompletionSlo);
+	if (System->setSystemMode(LoadControl::SystemSloMode)) InfoEdit->append("#change mode - slo " + metric + " " + QString::number(target) + " ms");
+}
+
+
+void parallelsystem::setSystemBanditMode(ThreadBandit::BanditRule rule)
+{
+	bool ok = false;
+	qreal oracle = QInputDialog::getDouble(this, "Bandit Mode", "Oracle throughput measured offline, tasks/sec (0 - best of the run):",
+		System->getOracleThroughput(), 0.0, 1e9, 2, &ok);
+	if (!ok) return;
+	if (IsRunning) reportRegret();
+	System->setOracleThroughput(oracle);
+	System->setBanditRule(rule);
+	if (System->setSystemMode(LoadControl::SystemBanditMode)) InfoEdit->append("#change mode - " + System->getModeString());
+}
+
+
+void parallelsystem::setSystemTrackingMode(LoadControl::TrackMetric metric)
+{
+	bool ok = false;
+	QString title = (metric == LoadControl::UtilisationTrack) ? "Utilisation Tracking" : (metric == LoadControl::RunQueueTrack) ? "Run Queue Tracking" : "Queue Wait Tracking";
+	QString label = (metric == LoadControl::UtilisationTrack) ? "Target share of the core budget busy:" : (metric == LoadControl::RunQueueTrack) ? "Target share of time waiting for a cpu:" : "Target queueing per task, ms:";
+	qreal initial = (metric == System->getTrackMetric()) ? System->getTrackTarget() : (metric == LoadControl::UtilisationTrack) ? 0.8 : (metric == LoadControl::RunQueueTrack) ? 0.05 : 100.0;
+	qreal target = QInputDialog::getDouble(this, title, label, initial, 0.0, (metric == LoadControl::QueueWaitTrack) ? 60000.0 : 1.0, 3, &ok);
+	if (!ok) return;
+	QStringList rules = QStringList() << "PID" << "AIMD";
+	QString rule = QInputDialog::getItem(this, title, "Feedback rule:", rules, (System->getTrackRule() == TrackingController::AimdRule) ? 1 : 0, false, &ok);
+	if (!ok) return;
+	int period = QInputDialog::getInt(this, title, "Sampling period, ms:", System->getTrackPeriod(), 100, 60000, 100, &ok);
+	if (!ok) return;
+	if (IsRunning) reportTracking();
+	System->setTrackingTarget(metric, target, period, (rule == rules[1]) ? TrackingController::AimdRule : TrackingController::PidRule);
+	if (System->setSystemMode(LoadControl::SystemTrackingMode)) InfoEdit->append("#change mode - " + System->getModeString() + " " + QString::number(target));
+}
+
+
+QString parallelsystem::getWorkloadName()
+{
+	ThreadTask::WorkType work = MyTaskManager->getWorkType();
+	QString workload = (work == ThreadTask::MemoryWork) ? "memory" : (work == ThreadTask::IoWork) ? "io" : (work == ThreadTask::TestWork) ? "test" : "cycle";
+	foreach (TaskQueue queue, MyTaskManager->getTaskQueues())
+	{
+		workload += " " + queue.getName() + ":" + QString::number(queue.getWeight()) + "/" + QString::number(queue.getRange());
+	}
+	return workload;
+}
+
+
+void parallelsystem::warmStart()
+{
+	if (!WarmStartAction->isChecked())
+		return;
+	ControlProfile profile(ControlProfile::fingerprint(PerfectThreadCount, getWorkloadName()));
+	if (!profile.load())
+	{
+		InfoEdit->append("#profile - none for this host and workload, cold start");
+		return;
+	}
+	int best = System->setProfile(profile);
+	if (best > 0)
+	{
+		ThreadNumberBox->setValue(best);
+		InfoEdit->append("#profile " + System->getModeString() + " - " + QString::number(profile.known()) + " thread numbers known, best " + QString::number(best));
+	}
+}
+
+
+void parallelsystem::saveProfile()
+{
+	if (!WarmStartAction->isChecked())
+		return;
+	ControlProfile profile = System->getProfile(ControlProfile::fingerprint(PerfectThreadCount, getWorkloadName()));
+	if (profile.known() > 0 && profile.save())
+	{
+		InfoEdit->append("#profile saved - " + QString::number(profile.known()) + " thread numbers known, best " + QString::number(profile.getBest()));
+	}
+}
+
+
+void parallelsystem::showDecisionLog()
+{
+	QDialog dialog(this);
+	dialog.setWindowTitle("Decision Log - " + QString::number(System->getAudit().count()) + " decisions");
+	dialog.resize(900, 500);
+	QTextEdit* log_edit = new QTextEdit(&dialog);
+	log_edit->setReadOnly(true);
+	log_edit->setLineWrapMode(QTextEdit::NoWrap);
+	log_edit->setStyleSheet("font: 8pt Courier New;");
+	log_edit->setPlainText(System->getAudit().lines().join("\n"));
+	log_edit->moveCursor(QTextCursor::End); // the newest decisions
+	QPushButton* export_button = new QPushButton("Export", &dialog);
+	export_button->setStyleSheet("font: 7pt Tahoma;");
+	connect(export_button, &QPushButton::clicked, this, &parallelsystem::exportDecisionLog);
+	QVBoxLayout* layout = new QVBoxLayout(&dialog);
+	layout->addWidget(log_edit);
+	layout->addWidget(export_button, 0, Qt::AlignRight);
+	dialog.exec();
+}
+
+
+void parallelsystem::exportDecisionLog()
+{
+	QString path = QFileDialog::getSaveFileName(this, "Export Decision Log", AUDITFILE, "CSV files (*.csv)");
+	if (path.isEmpty())
+		return;
+	if (System->getAudit().save(path)) InfoEdit->append("#audit - " + QString::number(System->getAudit().count()) + " decisions exported to " + path);
+}
+
+
+void parallelsystem::startBenchmark(int seconds, bool quit)
+{
+	if (IsRunning) changeState();
+	BenchSeconds = qMax(seconds, 30);
+	BenchQuit = quit;
+	BenchRuns.clear();
+	foreach (BenchScenario scenario, BenchScenario::scenarios(PerfectThreadCount))
+	{
+		for (int mode = 0; mode < BENCHMODES; mode++) BenchRuns.append(qMakePair(scenario, mode));
+	}
+	Bench.clear();
+	BenchWarmStart = WarmStartAction->isChecked();
+	WarmStartAction->setChecked(false); // every run starts cold
+	NoisyBox->setChecked(false);
+	SystemControlBox->setChecked(true);
+	InfoEdit->append("#benchmark - " + QString::number(BenchRuns.count()) + " runs, " + QString::number(BenchSeconds) + " sec each");
+	BenchIndex = -1;
+	nextBenchRun();
+}
+
+
+void parallelsystem::stopBenchmark()
+{
+	InfoEdit->append("#benchmark stopped - " + QString::number(Bench.count()) + " of " + QString::number(BenchRuns.count()) + " runs done");
+	BenchIndex = -1;
+	BenchRuns.clear();
+	Noisy->stop();
+	WarmStartAction->setChecked(BenchWarmStart);
+	changeMemoryState(MemoryBox->checkState());
+}
+
+
+QString parallelsystem::setBenchMode(LoadControl* control, int mode)
+{
+	switch (mode)
+	{
+	case 0: control->setSystemMode(LoadControl::SystemLightMode); break;
+	case 1: control->setSystemMode(LoadControl::SystemHardMode); break;
+	case 2: control->setSystemMode(LoadControl::SystemCriticalMode); break;
+	case 3: control->setSystemMode(LoadControl::SystemUslMode); break;
+	case 4: control->setSystemMode(LoadControl::SystemSearchMode); break;
+	case 5: control->setBanditRule(ThreadBandit::ThompsonRule); control->setSystemMode(LoadControl::SystemBanditMode); break;
+	case 6: control->setBanditRule(ThreadBandit::UcbRule); control->setSystemMode(LoadControl::SystemBanditMode); break;
+	case 7: control->setTrackingTarget(LoadControl::UtilisationTrack, 0.9); control->setSystemMode(LoadControl::SystemTrackingMode); break;
+	default: break;
+	}
+	return control->getModeString();
+}
+
+
+void parallelsystem::nextBenchRun()
+{
+	if (BenchIndex >= 0) // the current run is over
+	{
+		qreal steady = qMax(BenchClock.elapsed() / 1000.0 - BenchSeconds * (1 - BENCHSTEADY), 1.0);
+		BenchCurrent.Throughput = BenchTasks / steady;
+		foreach (qreal throughput, System->getProfile(QString()).getThroughputs()) BenchCurrent.Best = qMax(BenchCurrent.Best, throughput);
+		BenchCurrent.Churn = BenchChanges * 60.0 / BenchSeconds;
+		BenchCurrent.Tail = BenchHistogram.percentile(0.99);
+		IsRunning = false;
+		stopThreads();
+		Noisy->stop();
+		Bench.add(BenchCurrent);
+		InfoEdit->append("#benchmark " + BenchCurrent.Scenario + " " + BenchCurrent.Mode + " - " + QString::number(BenchCurrent.Throughput, 'f', 2) + " tasks/sec, "
+			+ QString::number(BenchCurrent.Churn, 'f', 1) + " changes/min, p99 " + QString::number(BenchCurrent.Tail, 'f', 0) + " ms");
+	}
+	BenchIndex++;
+	if (BenchIndex >= BenchRuns.count()) // comparison table
+	{
+		BenchTable baseline;
+		bool has_baseline = baseline.load();
+		foreach (QString line, Bench.table())
+		{
+			InfoEdit->append(line);
+			qDebug().noquote() << line;
+		}
+		if (has_baseline)
+		{
+			QStringList regressions = Bench.compare(baseline);
+			foreach (QString regression, regressions) InfoEdit->append("#benchmark regression - " + regression);
+			if (regressions.isEmpty()) InfoEdit->append("#benchmark - no regressions against " BENCHFILE);
+		}
+		Bench.save();
+		BenchIndex = -1;
+		BenchRuns.clear();
+		WarmStartAction->setChecked(BenchWarmStart);
+		changeMemoryState(MemoryBox->checkState());
+		if (BenchQuit) QCoreApplication::quit();
+		return;
+	}
+	BenchScenario scenario = BenchRuns[BenchIndex].first;
+	MyTaskManager->setWorkType((ThreadTask::WorkType)scenario.Work);
+	BenchCurrent = BenchResult();
+	BenchCurrent.Scenario = scenario.Name;
+	BenchCurrent.Mode = setBenchMode(System, BenchRuns[BenchIndex].second);
+	BenchChanges = 0;
+	BenchTasks = 0;
+	BenchHistogram.clear();
+	InfoEdit->append("#benchmark run " + QString::number(BenchIndex + 1) + "/" + QString::number(BenchRuns.count()) + " - " + scenario.Name + ", " + BenchCurrent.Mode);
+	ThreadNumberBox->setValue(1);
+	IsRunning = true;
+	startThreads();
+	BenchClock.start();
+	int run = BenchIndex;
+	if (scenario.ShiftWork >= 0)
+	{
+		QTimer::singleShot(BenchSeconds * 500, this, [this, run, scenario]() {
+			if (BenchIndex != run) return;
+			MyTaskManager->setWorkType((ThreadTask::WorkType)scenario.ShiftWork);
+			InfoEdit->append("#benchmark - work shift"); });
+	}
+	if (scenario.Noisy > 0)
+	{
+		QTimer::singleShot(BenchSeconds * 1000 / 3, this, [this, run, scenario]() {
+			if (BenchIndex != run) return;
+			Noisy->start(scenario.Noisy);
+			InfoEdit->append("#benchmark - noisy load on " + QString::number(scenario.Noisy)); });
+	}
+	QTimer::singleShot(BenchSeconds * 1000, this, [this, run]() { if (BenchIndex == run) nextBenchRun(); });
+}
+
+
+void parallelsystem::startSimulation(int seconds, quint32 seed, bool quit)
+{
+	if (IsRunning || BenchIndex >= 0)
+	{
+		InfoEdit->append("#simulation - stop the threads first");
+		return;
+	}
+	seconds = qMax(seconds, 30);
+	BenchTable table;
+	QElapsedTimer clock;
+	clock.start();
+	static QtMessageHandler handler = 0; // the controls of all runs would flood the log with debug lines, warnings still go through
+	handler = qInstallMessageHandler([](QtMsgType type, const QMessageLogContext& context, const QString& message) {
+		if (type != QtDebugMsg && handler != 0) handler(type, context, message); });
+	foreach (BenchScenario scenario, BenchScenario::scenarios(PerfectThreadCount))
+	{
+		// the true peak of the steady state (after the shift, with the noisy neighbour) is known analytically
+		SimWorkload steady = SimWorkload::forWork((scenario.ShiftWork >= 0) ? scenario.ShiftWork : scenario.Work, PerfectThreadCount, IOWAIT);
+		table.setOracle(scenario.Name, steady.peak(PerfectThreadCount * OVERSUBSCRIPTION, PerfectThreadCount, scenario.Noisy));
+		for (int mode = 0; mode < BENCHMODES; mode++) table.add(simulateRun(scenario, mode, seconds, seed));
+	}
+	qInstallMessageHandler(handler);
+	qreal real = qMax(clock.elapsed(), (qint64)1) / 1000.0;
+	InfoEdit->append("#simulation - " + QString::number(table.count()) + " runs, " + QString::number(seconds) + " virtual sec each, seed " + QString::number(seed) + ", done in "
+		+ QString::number(real, 'f', 1) + " sec (" + QString::number(table.count() * seconds / real, 'f', 0) + "x real time)");
+	foreach (QString line, table.table())
+	{
+		InfoEdit->append(line);
+		qDebug().noquote() << line;
+	}
+	BenchTable baseline;
+	if (baseline.load(BENCHSIMFILE))
+	{
+		QStringList regressions = table.compare(baseline);
+		foreach (QString regression, regressions) InfoEdit->append("#simulation regression - " + regression);
+		if (regressions.isEmpty()) InfoEdit->append("#simulation - no regressions against " BENCHSIMFILE);
+	}
+	table.save(BENCHSIMFILE);
+	if (quit) QMetaObject::invokeMethod(qApp, "quit", Qt::QueuedConnection); // started from main() before the event loop runs
+}
+
+
+BenchResult parallelsystem::simulateRun(BenchScenario scenario, int mode, int seconds, quint32 seed)
+{
+	SimClock clock;
+	LoadControl control(PerfectThreadCount);
+	control.setClock(&clock);
+	control.setSeed(seed);
+	PoolSimulator pool(&clock, PerfectThreadCount, PerfectThreadCount * OVERSUBSCRIPTION, seed);
+	pool.setWorkload(SimWorkload::forWork(scenario.Work, PerfectThreadCount, IOWAIT));
+	BenchResult result;
+	result.Scenario = scenario.Name;
+	result.Mode = setBenchMode(&control, mode);
+	qint64 steady = seconds * 1000 * (1 - BENCHSTEADY);
+	int changes = 0;
+	quint64 tasks = 0;
+	TimeHistogram histogram;
+
+	// the simulator takes the place of the task manager and the host monitors
+	connect(&pool, &PoolSimulator::finishTime, &control, &LoadControl::finishedTask);
+	connect(&pool, &PoolSimulator::finishInfo, &control, &LoadControl::finishedInfo);
+	connect(&pool, &PoolSimulator::runQueueDelay, &control, &LoadControl::setRunQueueDelay);
+	connect(&pool, &PoolSimulator::processLoad, &control, &LoadControl::setProcessLoad);
+	connect(&pool, &PoolSimulator::ceilingChanged, &control, &LoadControl::setThreadCeiling);
+	connect(&pool, &PoolSimulator::stepped, &control, &LoadControl::timeStep);
+	connect(&control, &LoadControl::addThread, &pool, &PoolSimulator::addThread);
+	connect(&control, &LoadControl::removeThread, &pool, &PoolSimulator::removeThread);
+	connect(&pool, &PoolSimulator::threadCountChanged, &control, [&control, &changes](int count, int transition) {
+		changes++;
+		control.setThreadCount(count); // after the pool change (closes the decision latency)
+		control.updateSystemState(transition); });
+	connect(&control, &LoadControl::converged, &control, [&result](qreal sec) { result.Converge = sec; });
+	connect(&pool, &PoolSimulator::finishTime, &control, [&clock, &tasks, &histogram, steady](int ms) {
+		if (clock.msecs() < steady) return;
+		tasks++;
+		histogram.add(ms); });
+
+	control.start(1);
+	pool.start(1);
+	if (scenario.Noisy > 0)
+	{
+		pool.runUntil(seconds * 1000 / 3);
+		pool.setNoisy(scenario.Noisy);
+	}
+	if (scenario.ShiftWork >= 0)
+	{
+		pool.runUntil(seconds * 500);
+		pool.setWorkload(SimWorkload::forWork(scenario.ShiftWork, PerfectThreadCount, IOWAIT));
+	}
+	pool.runUntil(seconds * 1000);
+
+	result.Throughput = tasks / (seconds * BENCHSTEADY);
+	foreach (qreal throughput, control.getProfile(QString()).getThroughputs()) result.Best = qMax(result.Best, throughput);
+	result.Churn = changes * 60.0 / seconds;
+	result.Tail = histogram.percentile(0.99);
+	control.finish();
+	return result;
+}
+
+
+void parallelsystem::reportTracking()
+{
+	if (System->getSystemMode() == LoadControl::SystemTrackingMode)
+	{
+		InfoEdit->append("#tracking " + System->getTrackString() + " - target " + QString::number(System->getTrackTarget()) + ", steady error "
+			+ QString::number(System->getTrackError(), 'g', 3));
+	}
+}
+
+
+void parallelsystem::reportRegret()
+{
+	if (System->getRegretTime() > 0)
+	{
+		QString oracle = (System->getOracleThroughput() > 0) ? QString::number(System->getOracleThroughput(), 'f', 2) + " tasks/sec" : QString("best of the run");
+		InfoEdit->append("#regret " + System->getModeString() + " - " + QString::number(System->getRegret(), 'f', 0) + " tasks in "
+			+ QString::number(System->getRegretTime(), 'f', 1) + " sec against " + oracle);
+	}
+}
+
+
+void parallelsystem::reportSlo()
+{
+	qreal task_share = System->getSloAttainment();
+	if (task_share >= 0)
+	{
+		qreal window_share = System->getSloWindowAttainment();
+		InfoEdit->append("#slo p" + QString::number(System->getSloShare() * 100) + (System->getSloMetric() == LoadControl::QueueSlo ? " queueing " : " completion ")
+			+ QString::number(System->getSloTarget()) + " ms - met by " + QString::number(task_share * 100, 'f', 1) + "% of tasks, "
+			+ (window_share >= 0 ? QString::number(window_share * 100, 'f', 1) + "%" : QString("n/a")) + " of windows");
+	}
+}
+
+
+void parallelsystem::reportSchedPolicy()
+{
+	qreal seconds = PolicyClock.elapsed() / 1000.0;
+	if (PolicyHistogram.count() > 0 && seconds > 0)
+	{
+		QString policy_string = (CurrentPolicy.getType() == SchedPolicy::UnknownPolicy) ? QString("inherit") : CurrentPolicy.getString();
+		InfoEdit->append("#policy " + policy_string + " - " + QString::number(PolicyHistogram.count() / seconds, 'f', 2) + " tasks/sec, p50 "
+			+ QString::number(PolicyHistogram.percentile(0.5), 'f', 1) + " ms, p99 " + QString::number(PolicyHistogram.percentile(0.99), 'f', 1) + " ms");
+	}
+}
+
+
+void parallelsystem::changeNoisyState(int state)
+{
+	if (state == Qt::Checked)
+	{
+		Noisy->start(qMax(PerfectThreadCount / 2, 1));
+		InfoEdit->append("#noisy load on " + QString::number(qMax(PerfectThreadCount / 2, 1)));
+	}
+	else if (state == Qt::Unchecked)
+	{
+		Noisy->stop();
+		InfoEdit->append("#noisy load off");
+	}
+}
+
+
+void parallelsystem::changeCeiling(int ceiling)
+{
+	InfoEdit->append("#ceiling " + QString::number(ceiling));
+	System->setThreadCeiling(ceiling);
+}
+
+
+void parallelsystem::changeBudget(int budget)
+{
+	InfoEdit->append("#budget " + QString::number(budget));
+	while (IsRunning && ThreadNumberBox->value() > budget * OVERSUBSCRIPTION) // quota is cut -> shed threads over it
+	{
+		removeThread(0.0);
+	}
+	PerfectThreadCount = budget;
+	ThreadNumberBox->setRange(1, PerfectThreadCount * OVERSUBSCRIPTION);
+	MyTaskManager->setPerfectThreadCount(PerfectThreadCount);
+	System->setPerfectThreadCount(PerfectThreadCount);
+	HostMonitor->setCoreBudget(PerfectThreadCount);
+	LoadChart->setThreadRange(qMax(System->getThreadLimit(), ThreadNumberBox->value()));
+	StarScaleChart->setThreadRange(PerfectThreadCount * OVERSUBSCRIPTION);
+}
+
+
+void parallelsystem::changeLimit(int limit)
+{
+	if (IsRunning) InfoEdit->append("#limit " + QString::number(limit));
+	LoadChart->setThreadRange(qMax(limit, ThreadNumberBox->value()));
+}
+
+
 void parallelsystem::addThread()
 {
-	if (ThreadNumberBox->value() < PerfectThreadCount + OVERLOAD)
+	if (ThreadNumberBox->value() < PerfectThreadCount * OVERSUBSCRIPTION)
 	{
 		ThreadNumberBox->setValue(ThreadNumberBox->value() + 1);
 		InfoEdit->append("#change " + QString::number(ThreadNumberBox->value()));
-		System->setThreadCount(ThreadNumberBox->value());
+		if (BenchIndex >= 0) BenchChanges++;
 		MyTaskManager->addThread();
+		System->setThreadCount(ThreadNumberBox->value()); // after the pool change (closes the decision latency)
 		System->updateSystemState(1);
 		LoadChart->addLoadPoint(ThreadNumberBox->value());
 	}
@@ -282,8 +974,9 @@ void parallelsystem::removeThread(qreal ms = 0.0)
 	{
 		ThreadNumberBox->setValue(ThreadNumberBox->value() - 1);
 		InfoEdit->append("#change " + QString::number(ThreadNumberBox->value()));
-		System->setThreadCount(ThreadNumberBox->value());
+		if (BenchIndex >= 0) BenchChanges++;
 		MyTaskManager->removeThread();
+		System->setThreadCount(ThreadNumberBox->value());
 		System->updateSystemState(-1);
 		LoadChart->addLoadPoint(ThreadNumberBox->value());
 		if (ms != 0.0) StarScaleChart->addOverloadPoint(ThreadNumberBox->value() + 1, ms);
@@ -291,10 +984,16 @@ void parallelsystem::removeThread(qreal ms = 0.0)
 }
 
 
-void parallelsystem::finishTask(int ms)
+void parallelsystem::finishTask(int ms, int cpu_ms)
 {
 	// inform the control system about the completion of the task
-	System->finishedTask(ms);
+	System->finishedTask(ms, cpu_ms);
+	PolicyHistogram.add(ms);
+	if (BenchIndex >= 0 && BenchClock.elapsed() >= BenchSeconds * 1000 * (1 - BENCHSTEADY))
+	{
+		BenchTasks++;
+		BenchHistogram.add(ms);
+	}
 }
 
 
@@ -303,10 +1002,11 @@ void parallelsystem::finishTask(int ms)
 
 void TaskManager::addThread()
 {
-	if (CurrentThreadNumber < PerfectThreadCount + OVERLOAD)
+	if (CurrentThreadNumber < PerfectThreadCount * OVERSUBSCRIPTION)
 	{
 		MyThreadPool.setMaxThreadCount(CurrentThreadNumber + 1);
 		CurrentThreadNumber++;
+		dispatch();
 	}
 }
 
@@ -323,7 +1023,7 @@ void TaskManager::removeThread()
 
 void TaskManager::setMaxThreadNumber(int num)
 {
-	if ((num >= 1) && (num < PerfectThreadCount + OVERLOAD + 1))
+	if ((num >= 1) && (num < PerfectThreadCount * OVERSUBSCRIPTION + 1))
 	{
 		MyThreadPool.setMaxThreadCount(num);
 		setCurrentThreadNumber(num);
@@ -340,21 +1040,39 @@ void TaskManager::addTask()
 {
 	if (CurrentThreadNumber > 0)
 	{
-		ThreadTask* task = new ThreadTask(TaskCount);
+		int queue = nextQueue();
+		TaskQueue& task_queue = TaskQueues[queue];
+		TaskInfo task_info(queue, task_queue.getName(), task_queue.takeTask(PerfectThreadCount * OVERSUBSCRIPTION + 1), task_queue.getCost(TaskWorkType));
+		if (task_queue.getDeadline() > 0) task_info.getDeadline() = task_info.getEnqueueTime() + task_queue.getDeadline();
+		ThreadTask* task = new ThreadTask(TaskCount, CountersEnabled, &Placement, TaskWorkType, TaskPolicy, task_queue.getRange(), task_info);
 		TaskCount++;
 		if (TaskCount == pow(2,64) - 1)
 			TaskCount = 0;
-		connect(task, SIGNAL(finish(ThreadState)), this, SLOT(addTask()));
-		connect(task, SIGNAL(finish(ThreadState)), this, SLOT(finishTask(ThreadState)));
+		connect(task, SIGNAL(finish(ThreadState, TaskInfo)), this, SLOT(finishTask(ThreadState, TaskInfo)));
 		MyThreadPool.start(task);
+		TasksInPool++;
 	}
 }
 
 
-void TaskManager::finishTask(ThreadState thread_state)
+void TaskManager::dispatch()
 {
-	emit finishTime(thread_state.getTime());
+	while (CurrentThreadNumber > 0 && TasksInPool < CurrentThreadNumber + 1) // the class is chosen when a thread gets free, not long before
+	{
+		addTask();
+	}
+}
+
+
+void TaskManager::finishTask(ThreadState thread_state, TaskInfo task_info)
+{
+	if (TasksInPool > 0) TasksInPool--;
+	qreal cost = task_info.getCost();
+	emit finishInfo(task_info); // the finish time goes first (start of the decision latency)
+	emit finishTime(round(thread_state.getTime() / cost), round(thread_state.getCpuTime() / cost)); // load control compares standard tasks
+	if (thread_state.hasCounters()) emit finishCounters(thread_state.getIpc());
 	emit finishThread(thread_state);
+	dispatch();
 }
 
 
@@ -362,15 +1080,9 @@ void TaskManager::startThreads(int ThreadNumber)
 {
 	setMaxThreadNumber(ThreadNumber);
 	TaskCount = 0;
-	for (int i = 0; i < PerfectThreadCount + OVERLOAD + 1; i++)
-	{
-		ThreadTask* task = new ThreadTask(TaskCount);
-		TaskCount++;
-		if (TaskCount == pow(2, 64) - 1)
-			TaskCount = 0;
-		connect(task, SIGNAL(finish(ThreadState)), this, SLOT(addTask()));
-		connect(task, SIGNAL(finish(ThreadState)), this, SLOT( finishTask(ThreadState)));
-		MyThreadPool.start(task);
-	}
-
+	TasksInPool = 0;
+	QueueRound = 0;
+	for (int i = 0; i < TaskQueues.count(); i++)
+		TaskQueues[i].clear();
+	dispatch();
 }
@@ -1,12 +1,23 @@
 #ifndef PARALLELSYSTEM_H
 #define PARALLELSYSTEM_H
 
-#define OVERLOAD 0 // number of threads allowed over IdealThreadCount
+#define OVERSUBSCRIPTION 4 // max threads per core of the budget (the control goes over the budget only while the threads block)
 
 #define SEARCH_RANGE 1000 //
+#define IOWAIT 12 // ms every i/o task blocks for (like a disk or network call)
 
 #include <QtWidgets/QMainWindow>
 #include "threadbase.h"
+#include "PerfCounters.h"
+#include "SystemMonitor.h"
+#include "NoisyNeighbour.h"
+#include "CpuTopology.h"
+#include "ControlClock.h"
+#include "ControlBase.h"
+#include "ControlProfile.h"
+#include "ControlAudit.h"
+#include "ControlBench.h"
+#include "PoolSimulator.h"
 #include <iostream>
 #include <qdebug.h>
 #include <qthreadpool.h>
@@ -21,6 +32,16 @@
 #include <QtCharts>
 #include <qmenu>
 #include <qmessagebox.h>
+#include <qthreadstorage.h>
+#include <qinputdialog.h>
+#include <qdialog.h>
+#include <qfiledialog.h>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 
 // THREAD TASK CLASS - tasks executing by every thread
@@ -30,16 +51,57 @@ class ThreadTask : public QObject, public QRunnable
 	Q_OBJECT
 
 public:
-	enum WorkType { CycleWork, TestWork };
-	ThreadTask(quint64 num) : id(num), work_type(CycleWork) { result = 0; }
+	enum WorkType { CycleWork, MemoryWork, TestWork, IoWork };
+	ThreadTask(quint64 num, bool counters = false, WorkerPlacement* worker_placement = 0, WorkType work = CycleWork, SchedPolicy sched_policy = SchedPolicy(),
+		int work_range = SEARCH_RANGE, TaskInfo task_info = TaskInfo())
+		: id(num), work_type(work), use_counters(counters), placement(worker_placement), policy(sched_policy), range(qMax(work_range, 1)), info(task_info) { result = 0; buffer = 0; }
+	static qreal cpuTime() // returns cpu time consumed by the calling thread (ms) or -1 if the platform doesn't provide it
+	{
+#ifdef Q_OS_LINUX
+		timespec cpu_time;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time) == 0)
+			return cpu_time.tv_sec * 1000.0 + cpu_time.tv_nsec / 1000000.0;
+#endif
+		return -1.0;
+	}
+	static PerfCounters* threadCounters() // returns counters of the calling thread (opened with the first request)
+	{
+		static QThreadStorage<PerfCounters*> storage;
+		if (!storage.hasLocalData())
+		{
+			PerfCounters* counters = new PerfCounters();
+			counters->open();
+			storage.setLocalData(counters);
+		}
+		return storage.localData();
+	}
+	static SchedPolicy threadPolicy(SchedPolicy policy) // applies the policy to the calling thread (once per change), returns the real policy of the thread
+	{
+		struct ThreadPolicy { SchedPolicy Wanted; SchedPolicy Real; };
+		static QThreadStorage<ThreadPolicy*> storage;
+		if (!storage.hasLocalData())
+		{
+			ThreadPolicy* thread_policy = new ThreadPolicy();
+			thread_policy->Real = SchedPolicy::current();
+			storage.setLocalData(thread_policy);
+		}
+		ThreadPolicy* thread_policy = storage.localData();
+		if (policy.getType() != SchedPolicy::UnknownPolicy && policy != thread_policy->Wanted)
+		{
+			policy.apply();
+			thread_policy->Wanted = policy;
+			thread_policy->Real = SchedPolicy::current();
+		}
+		return thread_policy->Real;
+	}
 	qint64 do_work()
 	{
 		switch (work_type) {
 		case CycleWork:
 		{
 			qint64 _result = 0;
-			for (qint64 j = -SEARCH_RANGE; j <= SEARCH_RANGE; j++) {
-				for (qint64 k = -SEARCH_RANGE; k <= SEARCH_RANGE; k++)
+			for (qint64 j = -range; j <= range; j++) {
+				for (qint64 k = -range; k <= range; k++)
 				{
 					_result = round(sqrt(id*id + j*j + k*k) / 3);
 				}
@@ -47,11 +109,38 @@ public:
 			return _result;
 			break;
 		}
+		case MemoryWork:
+		{
+			qint64 _result = 0;
+			if (buffer == 0) return 0;
+			for (int pass = 0; pass < qMax(range / 100, (qint64)1); pass++) {
+				for (int k = (id + pass) % 64; k < WORKBUFFER; k += 64) // one touch per cache line
+				{
+					buffer[k]++;
+					_result += buffer[k];
+				}
+			}
+			return _result;
+			break;
+		}
 		case TestWork:
 		{
 			return 0;
 			break;
 		}
+		case IoWork: // a quarter of the cycle work, then a blocking wait
+		{
+			qint64 _result = 0;
+			for (qint64 j = -range / 2; j <= range / 2; j++) {
+				for (qint64 k = -range / 2; k <= range / 2; k++)
+				{
+					_result = round(sqrt(id*id + j*j + k*k) / 3);
+				}
+			}
+			QThread::msleep(IOWAIT);
+			return _result;
+			break;
+		}
 		default:
 		{
 			qDebug() << "threadtask: invalid value | unknown type of work";
@@ -64,6 +153,7 @@ public:
 public slots:
 	void run() // task to load only CPU
 	{
+		info.getStartTime() = TaskInfo::now();
 		// setting priority options
 		if (id == 0) // the very first task
 		{
@@ -76,21 +166,54 @@ public slots:
 				QThread::currentThread()->setPriority(QThread::NormalPriority);
 			}
 		}
+		SchedPolicy thread_policy = threadPolicy(policy); // real scheduling class (qt priorities are mostly no-ops for SCHED_OTHER)
+		int slot = (placement != 0) ? placement->claim() : -1;
+		if (work_type == MemoryWork) buffer = (placement != 0) ? placement->buffer(slot) : WorkerPlacement::threadBuffer();
+		PerfCounters* counters = use_counters ? threadCounters() : 0;
+		PerfCounters::Sample counters_start;
+		if (counters != 0) counters_start = counters->read();
 		QTime timer;
 		timer.start();
+		qreal cpu_start = cpuTime();
 		// doing work
 		result = do_work();
 		// gathering information about thread state
-		ThreadState thread_state = ThreadState(QString("0x%1").arg((uint)QThread::currentThreadId(), 4, 16, QLatin1Char('0')), QThread::currentThread(), timer.elapsed(), QThread::currentThread()->priority());
-		emit finish(thread_state);
+		qint32 wall_time = timer.elapsed();
+		qreal cpu_finish = cpuTime();
+		qint32 cpu_time = (cpu_start < 0 || cpu_finish < 0) ? wall_time : qMin(wall_time, (qint32)round(cpu_finish - cpu_start)); // no thread clock -> count the task as fully on cpu
+		ThreadState thread_state = ThreadState(QString("0x%1").arg((uint)QThread::currentThreadId(), 4, 16, QLatin1Char('0')), QThread::currentThread(), wall_time, cpu_time, QThread::currentThread()->priority());
+#ifdef Q_OS_LINUX
+		thread_state.setTid(syscall(SYS_gettid));
+#endif
+		thread_state.setPolicy(thread_policy);
+		if (slot >= 0)
+		{
+			thread_state.setPlace(placement->getTopology().getPlaceString(slot));
+			thread_state.setNode(placement->getTopology().at(slot).Node);
+			placement->release(slot);
+		}
+		if (counters != 0)
+		{
+			PerfCounters::Sample counters_finish = counters->read();
+			thread_state.setCounters(counters_finish.Cycles - counters_start.Cycles, counters_finish.Instructions - counters_start.Instructions,
+				counters_finish.Misses - counters_start.Misses, counters_finish.Switches - counters_start.Switches);
+		}
+		info.getFinishTime() = TaskInfo::now();
+		emit finish(thread_state, info);
 	}
 
 signals:
-	void finish(ThreadState thread_state);
+	void finish(ThreadState thread_state, TaskInfo task_info);
 
 private:
 	const quint64 id = 0; // task id
 	const WorkType work_type; // type of work to do
+	const bool use_counters; // reads per thread perf counters around the work
+	WorkerPlacement* placement; // pins the thread for the time of the work (0 - no pinning)
+	char* buffer; // worker's memory for memory work (node local if the thread is pinned)
+	const SchedPolicy policy; // scheduling class to run the work with (UnknownPolicy - leave the thread as is)
+	const qint64 range; // work size (cycle work grows with range^2, memory work with range)
+	TaskInfo info; // class and queueing times of the task
 	qint64 result;
 
 };
@@ -100,33 +223,31 @@ private:
 
 #define WAITCOUNT 9 // min number of completed task to wait for
 #define SCALE 2 // waitcount multiplier
-#define DATADEPTH 20 // maximum depth for data arrays
+#define STABLECOUNT 5 // number of windows without thread changes to consider the control converged
 
 class LoadControl : public QObject
 {
 	Q_OBJECT
 
 public:
-	LoadControl(int ideal_thread_count) : PerfectThreadCount(ideal_thread_count)
+	LoadControl(int ideal_thread_count)
 	{
+		TrackTimer = new QTimer(this); // setSystemMode stops it
+		connect(TrackTimer, &QTimer::timeout, this, &LoadControl::trackThread);
+		setPerfectThreadCount(ideal_thread_count);
 		reset(0);
 		setSystemMode(SystemLightMode);
-		for (int i = 0; i < DATADEPTH; i++)
-		{
-			TaskTimeArray[i] = QPointF(0.0, 0.0);
-		}
+		clearProfile();
 		IsRunning = false;
 		IsStopped = false;
 		ThreadCount = 0;
-		SystemState = 0;
-		UpLock = false;
-		UpLockCount = 0;
-		UpLockTimer = new QTimer(this);
-		connect(UpLockTimer, &QTimer::timeout, this, &LoadControl::unlockUp);
-		UpLockTimer->setSingleShot(true);
+		ControlClock.start();
 	}
 
-	enum SystemMode { SystemLightMode, SystemHardMode, SystemCriticalMode };
+	enum SystemMode { SystemLightMode, SystemHardMode, SystemCriticalMode, SystemDeadlineMode, SystemSloMode, SystemUslMode, SystemSearchMode, SystemBanditMode, SystemTrackingMode }; // the last one closes the range setSystemMode accepts
+	enum SloMetric { CompletionSlo, QueueSlo }; // enqueue to finish time or time waiting for a thread
+	enum TrackMetric { UtilisationTrack, RunQueueTrack, QueueWaitTrack }; // process cpu share of the budget, run queue wait share per worker, ms of queueing per task
+	enum PlaceKind { CorePlace, SiblingPlace, SpillPlace }; // new physical core, SMT sibling, first core of the next numa node
 
 	void start(int count) // starts automatic managing executing threads
 	{
@@ -134,7 +255,24 @@ public:
 		{
 			IsRunning = true;
 			ThreadCount = count;
-			reset(-count);
+			ThreadLimit = qBound(PerfectThreadCount, count, PerfectThreadCount * OVERSUBSCRIPTION); // a manual start over the budget is kept
+			updateCeiling();
+			if (ThreadLimit > PerfectThreadCount) emit threadLimitChanged(ThreadLimit);
+			SloTasks = 0;
+			SloMetTasks = 0;
+			SloWindows = 0;
+			SloMetWindows = 0;
+			restartConvergence();
+			if (Mode == SystemSearchMode) Search.start(1, ThreadCeiling);
+			if (Mode == SystemBanditMode) Bandit.start(PerfectThreadCount * OVERSUBSCRIPTION, Rule);
+			if (Mode == SystemTrackingMode) startTracking();
+			seedProfile();
+			Regret = 0;
+			RegretTime = 0;
+			Audit.clear();
+			Oscillation.clear();
+			ChangeClockTime = ControlClock.elapsed();
+			warmup();
 			qDebug() << "loadcontrol: turned on |" << count << "threads";
 		}
 		else
@@ -147,7 +285,7 @@ public:
 	{
 		IsRunning = false;
 		IsStopped = true;
-		UpLockCount = 0;
+		Oscillation.clear();
 		qDebug() << "loadcontrol: stop";
 	};
 
@@ -155,13 +293,19 @@ public:
 	{
 		IsRunning = false;
 		IsStopped = false;
-		SystemState = 0;
-		UpLock = false;
-		UpLockCount = 0;
-		for (int i = 0; i < DATADEPTH; i++)
-		{
-			TaskTimeArray[i] = QPointF(0.0, 0.0);
-		}
+		Oscillation.clear();
+		RunQueueDelay = -1;
+		ProcessLoad = -1;
+		TrackTimer->stop();
+		NextTrackTime = -1;
+		ThreadLimit = PerfectThreadCount;
+		updateCeiling();
+		clearProfile();
+		Model.clear();
+		ModelTarget = 0;
+		Search.clear();
+		TimeDetector.clear();
+		ThroughputDetector.clear();
 		qDebug() << "loadcontrol: turned off";
 	}
 
@@ -170,10 +314,38 @@ public:
 		if (IsRunning)
 		{
 			AvgTime = 0;
+			AvgCpuRatio = 0;
+			TaskStats.clear();
+			AvgIpc = 0;
+			IpcCount = 0;
+			DelayCount = 0;
+			DeadlineCount = 0;
+			MissCount = 0;
+			SloHistogram.clear();
 			TaskCount = count;
 		}
 	}
 
+	void warmup() // waits till the task times at the (new) thread number settle
+	{
+		reset(-1);
+		Warmup.start(ThreadCount + 1); // the task that triggered the change and the ones in flight with it
+		WarmupClock.start();
+		Warming = true;
+	}
+
+	bool warmupThread(int ms) // returns true if the warm-up is over with this task
+	{
+		if (!Warming)
+			return true;
+		if (!Warmup.add(ms))
+			return false;
+		Warming = false;
+		qDebug() << "loadcontrol: warm-up |" << ThreadCount << "threads" << Warmup.count() << "tasks" << WarmupClock.elapsed() << "ms";
+		emit warmedUp(ThreadCount, Warmup.count(), WarmupClock.elapsed());
+		return true;
+	}
+
 	void setXTimeData(int i, qreal ms)
 	{
 		if ((TaskTimeArray[i - 1].x() == 0) || (TaskTimeArray[i - 1].x() > ms)) // initialization of x value or ms < current x value
@@ -217,42 +389,418 @@ public:
 		return TaskTimeArray[i-1].x();
 	}
 
-	void lockUp()
+	int getWindowSize() // tasks of a window at the current thread number (more for noisy task times, less for quiet ones)
 	{
-		if (IsRunning)
+		return qBound(WAITCOUNT, TaskStats.required(WindowPrecision, WindowZ), WAITCOUNT * SCALE * 4);
+	}
+
+	void setIpcData(int i, qreal ipc)
+	{
+		if (i >= 1 && ipc > 0)
 		{
-			UpLock = true;
-			if (UpLockCount < 10) UpLockCount++;
-			if (UpLockCount > 0) UpLockTimer->start(UpLockCount * 1000);
-			qDebug() << "loadcontrol: lock up for" << UpLockCount << "sec";
+			if (IpcArray[i - 1] == 0) IpcArray[i - 1] = ipc;
+			else IpcArray[i - 1] = (WAITCOUNT * SCALE * IpcArray[i - 1] + ipc) / (WAITCOUNT * SCALE + 1);
 		}
-		else
+	}
+
+	void setMissData(int i, qreal miss_rate)
+	{
+		if (i >= 1 && miss_rate >= 0)
 		{
-			qDebug() << "loadcontrol: automatic managing is off";
+			if (MissArray[i - 1] < 0) MissArray[i - 1] = miss_rate;
+			else MissArray[i - 1] = (WAITCOUNT * SCALE * MissArray[i - 1] + miss_rate) / (WAITCOUNT * SCALE + 1);
 		}
 	}
 
-	void updateSystemState(int transition)
+	void setThroughputData(int i, qreal throughput)
 	{
-		// system state update (default: +1 - add thread; -1 - remove thread)
-		SystemState = SystemState << 1;
-		if (transition > 0) { SystemState++; }
+		if (i >= 1 && throughput > 0)
+		{
+			if (ThroughputArray[i - 1] == 0) ThroughputArray[i - 1] = throughput;
+			else ThroughputArray[i - 1] = (WAITCOUNT * SCALE * ThroughputArray[i - 1] + throughput) / (WAITCOUNT * SCALE + 1);
+			fitModel();
+		}
+	}
 
-		// lock up checking (one + two transitions cycles)
-		if (SystemState % 16 == 10 || SystemState % 256 == 153 || SystemState % 256 == 204) // last 4 transitions == 1010 or last 8 transitions == 10011001 || 11001100
+	void setSloData(int i, qreal tail)
+	{
+		if (i >= 1 && tail >= 0)
 		{
-			lockUp();
+			if (TailArray[i - 1] < 0) TailArray[i - 1] = tail;
+			else TailArray[i - 1] = (WAITCOUNT * SCALE * TailArray[i - 1] + tail) / (WAITCOUNT * SCALE + 1);
+			SloWindows++;
+			if (tail <= SloTarget) SloMetWindows++;
 		}
-		else if (SystemState % 4 == 3 || SystemState % 4 == 0) // two same transition in row (11 or 00)
+	}
+
+	void fitModel() // fits the scalability model to the measured throughput
+	{
+		QVector<QPointF> points;
+		for (int i = 0; i < ThroughputArray.count(); i++)
 		{
-			UpLockCount = 0;
+			if (ThroughputArray[i] > 0) points.append(QPointF(i + 1, ThroughputArray[i]));
 		}
-		else
+		if (Model.fit(points))
+		{
+			emit modelChanged(Model);
+		}
+	}
+
+	int getModelPeak() // returns the thread number the model predicts the most throughput for (0 if the model isn't valid)
+	{
+		if (!Model.isValid())
+			return 0;
+		qreal peak = Model.peak();
+		if (peak == 0) // no retrograde part -> the more the better
+			return ThreadCeiling;
+		return qBound(1, (int)round(peak), ThreadCeiling);
+	}
+
+	void jumpThread(int count) // changes the thread number in one go (the caller has set the cause of the audit log)
+	{
+		qDebug() << "loadcontrol: model jump |" << ThreadCount << "->" << count;
+		Audit.decide(ThreadCount, count);
+		while (ThreadCount < count)
+		{
+			int last = ThreadCount;
+			emit addThread();
+			if (ThreadCount == last) break; // couldn't add
+		}
+		while (ThreadCount > count)
+		{
+			int last = ThreadCount;
+			emit removeThread(0.0);
+			if (ThreadCount == last) break; // couldn't remove
+		}
+	}
+
+	bool searchThread(qreal throughput) // returns true if the search moved to the next probe (window throughput of the current thread number)
+	{
+		if (Mode != SystemSearchMode || Search.isOver())
+			return false;
+		Search.measured(ThreadCount, throughput);
+		Audit.cause(ControlDecision::SearchReason, throughput, 0, Search.probes());
+		int next = Search.next();
+		if (next == 0) // search is over -> settle on the best probe, steps track it from now on
+		{
+			next = Search.best();
+			qDebug() << "loadcontrol: search is over |" << next << "threads after" << Search.probes() << "probes";
+			emit searchFinished(next, Search.probes());
+		}
+		if (next > 0 && next != ThreadCount)
+		{
+			jumpThread(next);
+			return true;
+		}
+		else return false;
+	}
+
+	bool detectChange() // returns true if the workload shifted (task time or throughput left the learned level of the thread number)
+	{
+		int time_shift = 0, throughput_shift = 0;
+		if (TaskTimeArray[ThreadCount - 1].x() > 0) time_shift = TimeDetector.add(AvgTime / TaskTimeArray[ThreadCount - 1].x());
+		if (ThroughputArray[ThreadCount - 1] > 0 && getThroughput() > 0) throughput_shift = ThroughputDetector.add(getThroughput() / ThroughputArray[ThreadCount - 1]);
+		if (time_shift == 0 && throughput_shift == 0)
+			return false;
+		QString shift = (time_shift != 0) ? QString(time_shift > 0 ? "task time up" : "task time down") : QString(throughput_shift > 0 ? "throughput up" : "throughput down");
+		qDebug() << "loadcontrol: workload change |" << shift;
+		if (time_shift != 0) Audit.cause(ControlDecision::ShiftReason, AvgTime, TaskTimeArray[ThreadCount - 1].x(), TaskCount);
+		else Audit.cause(ControlDecision::ShiftReason, getThroughput(), ThroughputArray[ThreadCount - 1], TaskCount);
+		Audit.decide(ThreadCount, ThreadCount);
+		invalidateProfile();
+		emit workloadChanged(shift);
+		return true;
+	}
+
+	void resizeProfile(int depth) // sizes the per thread number data for 'depth' thread numbers (never shrinks, new ones are unknown)
+	{
+		int known = TaskTimeArray.count();
+		if (depth <= known)
+			return;
+		TaskTimeArray.resize(depth);
+		IpcArray.resize(depth);
+		MissArray.resize(depth);
+		TailArray.resize(depth);
+		ThroughputArray.resize(depth);
+		TimeStats.resize(depth);
+		for (int i = known; i < depth; i++)
+		{
+			TaskTimeArray[i] = QPointF(0.0, 0.0);
+			IpcArray[i] = 0.0;
+			MissArray[i] = -1.0;
+			TailArray[i] = -1.0;
+			ThroughputArray[i] = 0.0;
+			TimeStats[i].clear();
+		}
+		qDebug() << "loadcontrol: profile depth |" << depth << "thread numbers";
+	}
+
+	void clearProfile() // forgets the per thread number data
+	{
+		TaskTimeArray.fill(QPointF(0.0, 0.0));
+		IpcArray.fill(0.0);
+		MissArray.fill(-1.0);
+		TailArray.fill(-1.0);
+		ThroughputArray.fill(0.0);
+		TimeStats.fill(RunningStats());
+	}
+
+	void invalidateProfile() // forgets what was learned about every thread number and explores again
+	{
+		clearProfile();
+		Model.clear();
+		ModelTarget = 0;
+		if (Mode == SystemSearchMode) Search.start(1, ThreadCeiling);
+		if (Mode == SystemBanditMode) Bandit.start(PerfectThreadCount * OVERSUBSCRIPTION, Rule);
+		TimeDetector.clear();
+		ThroughputDetector.clear();
+		Oscillation.clear();
+		restartConvergence();
+	}
+
+	ControlProfile getProfile(QString key) // returns what was learned about every thread number (for the warm start of the next run)
+	{
+		ControlProfile profile(key);
+		profile.getMode() = Mode;
+		profile.getBest() = ThreadCount;
+		qreal best = 0;
+		for (int i = 0; i < ThroughputArray.count(); i++)
+		{
+			if (ThroughputArray[i] > best) { best = ThroughputArray[i]; profile.getBest() = i + 1; }
+		}
+		profile.getTimes() = TaskTimeArray;
+		profile.getThroughputs() = ThroughputArray;
+		profile.getIpcs() = IpcArray;
+		return profile;
+	}
+
+	int setProfile(ControlProfile profile) // loads a saved profile before the start, returns the thread number to start with (0 if the profile knows nothing)
+	{
+		if (profile.known() == 0)
+			return 0;
+		clearProfile();
+		resizeProfile(profile.getTimes().count());
+		for (int i = 0; i < profile.getTimes().count(); i++)
+		{
+			TaskTimeArray[i] = profile.getTimes()[i];
+			if (TaskTimeArray[i].x() > 0) emit timeDataChanged(i + 1, TaskTimeArray[i]);
+		}
+		for (int i = 0; i < profile.getThroughputs().count() && i < ThroughputArray.count(); i++) ThroughputArray[i] = profile.getThroughputs()[i];
+		for (int i = 0; i < profile.getIpcs().count() && i < IpcArray.count(); i++) IpcArray[i] = profile.getIpcs()[i];
+		fitModel();
+		if (profile.getMode() >= SystemLightMode && profile.getMode() <= SystemTrackingMode) setSystemMode((SystemMode)profile.getMode());
+		TimeDetector.clear();
+		ThroughputDetector.clear();
+		qDebug() << "loadcontrol: profile loaded |" << profile.known() << "thread numbers known, best" << profile.getBest();
+		return qBound(1, profile.getBest(), PerfectThreadCount * OVERSUBSCRIPTION);
+	}
+
+	void seedProfile() // hands the known throughputs to the search and the bandit (a warm start verifies instead of exploring)
+	{
+		for (int i = 0; i < ThroughputArray.count(); i++)
+		{
+			if (ThroughputArray[i] <= 0) continue;
+			if (Mode == SystemSearchMode && i + 1 <= ThreadCeiling) Search.measured(i + 1, ThroughputArray[i]);
+			if (Mode == SystemBanditMode) Bandit.update(i + 1, ThroughputArray[i]);
+		}
+	}
+
+	void restartConvergence()
+	{
+		StableCount = 0;
+		ChangeTime = 0;
+		Converged = false;
+		ConvergeWindows.clear();
+		ConvergeClock.start();
+	}
+
+	bool banditThread(qreal seconds, qreal throughput) // returns true if the bandit moved to another arm (window duration and throughput of the current thread number)
+	{
+		if (Mode != SystemBanditMode)
+			return false;
+		Bandit.update(ThreadCount, throughput);
+		qreal oracle = OracleThroughput;
+		if (oracle <= 0) // no offline oracle -> best throughput measured in this run
+		{
+			foreach (qreal throughput, ThroughputArray) oracle = qMax(oracle, throughput);
+		}
+		Regret += qMax(0.0, oracle - throughput) * seconds;
+		RegretTime += seconds;
+		Audit.cause(ControlDecision::BanditReason, throughput, oracle, TaskCount);
+		int next = Bandit.choose(ThreadCeiling);
+		if (next != ThreadCount)
+		{
+			jumpThread(next);
+			return true;
+		}
+		else return false;
+	}
+
+	void setBanditRule(ThreadBandit::BanditRule rule) { Rule = rule; }
+	void setOracleThroughput(qreal throughput) { OracleThroughput = throughput; } // best throughput measured offline (0 - use the best one of the run)
+	qreal getOracleThroughput() { return OracleThroughput; }
+	qreal getRegret() { return Regret; } // tasks lost against the oracle in the bandit mode
+	qreal getRegretTime() { return RegretTime; } // sec measured in the bandit mode
+
+	void checkConvergence(qreal seconds, qreal throughput) // counts windows without thread changes, reports the exploration cost once they are stable
+	{
+		if (Converged || !ConvergeClock.isValid())
+			return;
+		ConvergeWindows.append(QPointF(seconds, throughput));
+		StableCount++;
+		if (StableCount < STABLECOUNT)
+			return;
+		Converged = true;
+		int windows = ConvergeWindows.count() - STABLECOUNT; // exploration windows
+		qreal settled = 0;
+		for (int i = windows; i < ConvergeWindows.count(); i++) settled += ConvergeWindows[i].y() / STABLECOUNT;
+		qreal lost = 0; // tasks the exploration cost against the settled throughput
+		for (int i = 0; i < windows; i++) lost += qMax(0.0, settled - ConvergeWindows[i].y()) * ConvergeWindows[i].x();
+		qDebug() << "loadcontrol: converged |" << getModeString() << ChangeTime << "sec" << windows << "windows" << lost << "tasks lost";
+		emit converged(ChangeTime, windows, lost);
+	}
+
+	SystemMode getSystemMode() { return Mode; }
+
+	QString getModeString()
+	{
+		switch (Mode)
+		{
+		case SystemLightMode: return QString("light");
+		case SystemHardMode: return QString("hard");
+		case SystemCriticalMode: return QString("critical");
+		case SystemDeadlineMode: return QString("deadline");
+		case SystemSloMode: return QString("slo");
+		case SystemUslMode: return QString("usl");
+		case SystemSearchMode: return QString("search");
+		case SystemBanditMode: return QString(Rule == ThreadBandit::UcbRule ? "ucb" : "thompson");
+		case SystemTrackingMode: return getTrackString();
+		default: return QString("unknown");
+		}
+	}
+
+	void setTrackingTarget(TrackMetric metric, qreal target, int period = 1000, TrackingController::TrackingRule rule = TrackingController::PidRule) // sets what the tracking mode holds and how often it steps
+	{
+		Tracked = metric;
+		TrackTarget = target;
+		TrackPeriod = qMax(period, 100);
+		TrackRule = rule;
+		if (Mode == SystemTrackingMode) startTracking();
+	}
+
+	void startTracking() // restarts the tracking loop from the current thread number
+	{
+		Tracker.start(TrackTarget, qMax(ThreadCount, 1), PerfectThreadCount, TrackRule, (Tracked == QueueWaitTrack) ? -1 : 1);
+		Tracker.setMaxStep(qMax(PerfectThreadCount / 2, 1));
+		QueueWaitSum = 0;
+		QueueWaitCount = 0;
+		TrackClock.start();
+		if (Clock->isVirtual()) NextTrackTime = Clock->msecs() + TrackPeriod; // stepped by timeStep()
+		else TrackTimer->start(TrackPeriod);
+		qDebug() << "loadcontrol: tracking |" << getTrackString() << "target" << TrackTarget << "every" << TrackPeriod << "ms";
+	}
+
+	qreal getTrackedValue() // returns the tracked value measured since the last step (-1 if unknown)
+	{
+		switch (Tracked)
+		{
+		case UtilisationTrack: return ProcessLoad;
+		case RunQueueTrack: return RunQueueDelay;
+		case QueueWaitTrack: return (QueueWaitCount > 0) ? QueueWaitSum / QueueWaitCount : -1.0;
+		default: return -1.0;
+		}
+	}
+
+	QString getTrackString()
+	{
+		QString metric = (Tracked == UtilisationTrack) ? "utilisation" : (Tracked == RunQueueTrack) ? "run queue" : "queue wait";
+		return metric + ((TrackRule == TrackingController::AimdRule) ? " aimd" : " pid");
+	}
+
+	TrackMetric getTrackMetric() { return Tracked; }
+	qreal getTrackTarget() { return TrackTarget; }
+	int getTrackPeriod() { return TrackPeriod; }
+	TrackingController::TrackingRule getTrackRule() { return TrackRule; }
+	qreal getTrackError() { return Tracker.steadyError(); } // mean target - measured of the last samples
+
+	bool modelThread() // returns true if the thread number jumped close to the predicted peak
+	{
+		int peak = getModelPeak();
+		if (Mode == SystemUslMode && peak > 0 && qAbs(peak - ThreadCount) >= ModelJump && peak != ModelTarget)
 		{
-			// do nothing
+			ModelTarget = peak; // each prediction is jumped to once, the steps refine it
+			Audit.cause(ControlDecision::ModelReason, peak, ModelJump); // predicted peak and the min distance worth a jump
+			jumpThread(peak);
+			return true;
 		}
+		else return false;
 	}
 
+	UslModel& getModel() { return Model; }
+
+	void setSloTarget(qreal ms, SloMetric metric = CompletionSlo, qreal share = 0.99) // sets the tail latency target of the slo mode
+	{
+		SloTarget = qMax(ms, 1.0);
+		Metric = metric;
+		SloShare = qBound(0.5, share, 0.999);
+		TailArray.fill(-1.0); // measured against the old target
+		qDebug() << "loadcontrol: slo target | p" << SloShare * 100 << (Metric == QueueSlo ? "queueing" : "completion") << SloTarget << "ms";
+	}
+
+	qreal getTail() // returns the slo percentile of the tasks at the current thread number (-1 if not enough tasks)
+	{
+		if (SloHistogram.count() < WAITCOUNT)
+			return -1.0;
+		return SloHistogram.percentile(SloShare);
+	}
+
+	qreal getThroughput() // returns tasks per second at the current thread number (0 if unknown)
+	{
+		if (TaskCount <= 0 || !WindowClock.isValid() || WindowClock.elapsed() == 0)
+			return 0.0;
+		return TaskCount * 1000.0 / WindowClock.elapsed();
+	}
+
+	qreal getSloAttainment() { if (SloTasks == 0) { return -1.0; } else { return (qreal)SloMetTasks / SloTasks; }} // share of tasks within the target (-1 if none)
+	qreal getSloWindowAttainment() { if (SloWindows == 0) { return -1.0; } else { return (qreal)SloMetWindows / SloWindows; }} // share of windows with the percentile within the target
+	qreal getSloTarget() { return SloTarget; }
+	SloMetric getSloMetric() { return Metric; }
+	qreal getSloShare() { return SloShare; }
+
+	qreal getMissRate() // returns deadline miss rate of the tasks at the current thread number (-1 if not enough tasks with deadlines)
+	{
+		if (DeadlineCount < WAITCOUNT)
+			return -1.0;
+		return (qreal)MissCount / DeadlineCount;
+	}
+
+	void updateSystemState(int transition) // looks for a limit cycle after every thread change (+1 - thread added, -1 - removed)
+	{
+		qint64 now = ControlClock.elapsed();
+		int left = ThreadCount - transition;
+		qreal dwell = (now - ChangeClockTime) / 1000.0;
+		ChangeClockTime = now;
+		if (!IsRunning || !isStepping()) // the search, the bandit and the tracking loop move on purpose
+			return;
+		qreal throughput = (left >= 1 && left <= ThroughputArray.count()) ? ThroughputArray[left - 1] : 0.0;
+		qreal lost = Oscillation.lost();
+		int period = Oscillation.add(ThreadCount, dwell, throughput, now);
+		if (period > 0)
+		{
+			int direction = Oscillation.direction();
+			qDebug() << "loadcontrol: oscillation | period" << period << "lock" << (direction > 0 ? "up" : "down") << Oscillation.lockLeft(direction, now) << "ms"
+				<< Oscillation.lost() - lost << "tasks lost";
+			emit oscillated(period, direction, Oscillation.lockLeft(direction, now), Oscillation.lost());
+		}
+	}
+
+	bool isStepping() // returns true if the thread number is moved by the overload and underload rules
+	{
+		return Mode != SystemBanditMode && Mode != SystemTrackingMode && !(Mode == SystemSearchMode && !Search.isOver());
+	}
+
+	OscillationDetector& getOscillation() { return Oscillation; }
+
 	bool changeState(int state)
 	{
 		if (state == Qt::Checked && IsRunning == false && IsStopped == true) { start(ThreadCount); return true; }
@@ -262,11 +810,22 @@ public:
 
 	bool setSystemMode(SystemMode mode)
 	{
+		if (mode < SystemLightMode || mode > SystemTrackingMode) // nothing changes on an unknown mode
+		{
+			qDebug() << "loadcontrol: invalid value | unknown system mode";
+			return false;
+		}
+		Mode = mode;
+		if (mode != SystemTrackingMode) { TrackTimer->stop(); NextTrackTime = -1; }
+		if (IsRunning) restartConvergence(); // every mode is measured from its own start
 		switch (mode) {
 		case SystemLightMode:
 		{
 			WaitFactor = 0.25;
 			AllowedZoneFactor = 2.0;
+			PreemptFactor = 0.75;
+			IpcDropFactor = 0.8;
+			DelayFactor = 0.15;
 			qDebug() << "loadcontrol: set system mode | light";
 			break;
 		}
@@ -274,6 +833,9 @@ public:
 		{
 			WaitFactor = 0.5;
 			AllowedZoneFactor = 1.75;
+			PreemptFactor = 0.8;
+			IpcDropFactor = 0.85;
+			DelayFactor = 0.1;
 			qDebug() << "loadcontrol: set system mode | hard";
 			break;
 		}
@@ -281,66 +843,442 @@ public:
 		{
 			WaitFactor = 1.0;
 			AllowedZoneFactor = 1.5;
+			PreemptFactor = 0.85;
+			IpcDropFactor = 0.9;
+			DelayFactor = 0.05;
 			qDebug() << "loadcontrol: set system mode | critical";
 			break;
 		}
-		default:
+		case SystemDeadlineMode:
 		{
-			qDebug() << "loadcontrol: invalid value | unknown system mode";
-			return false;
+			WaitFactor = 0.5;
+			AllowedZoneFactor = 1.75;
+			PreemptFactor = 0.8;
+			IpcDropFactor = 0.85;
+			DelayFactor = 0.1;
+			qDebug() << "loadcontrol: set system mode | deadline";
+			break;
+		}
+		case SystemSloMode:
+		{
+			WaitFactor = 0.5;
+			AllowedZoneFactor = 1.75;
+			PreemptFactor = 0.8;
+			IpcDropFactor = 0.85;
+			DelayFactor = 0.1;
+			qDebug() << "loadcontrol: set system mode | slo";
+			break;
+		}
+		case SystemUslMode:
+		{
+			WaitFactor = 0.25;
+			AllowedZoneFactor = 2.0;
+			PreemptFactor = 0.75;
+			IpcDropFactor = 0.8;
+			DelayFactor = 0.15;
+			ModelTarget = 0;
+			qDebug() << "loadcontrol: set system mode | usl";
+			break;
+		}
+		case SystemSearchMode:
+		{
+			WaitFactor = 0.25;
+			AllowedZoneFactor = 2.0;
+			PreemptFactor = 0.75;
+			IpcDropFactor = 0.8;
+			DelayFactor = 0.15;
+			Search.start(1, ThreadCeiling);
+			qDebug() << "loadcontrol: set system mode | search";
+			break;
 		}
+		case SystemBanditMode:
+		{
+			WaitFactor = 0.25;
+			AllowedZoneFactor = 2.0;
+			PreemptFactor = 0.75;
+			IpcDropFactor = 0.8;
+			DelayFactor = 0.15;
+			Bandit.start(PerfectThreadCount * OVERSUBSCRIPTION, Rule);
+			Regret = 0;
+			RegretTime = 0;
+			qDebug() << "loadcontrol: set system mode | bandit" << (Rule == ThreadBandit::UcbRule ? "ucb" : "thompson");
+			break;
+		}
+		case SystemTrackingMode:
+		{
+			WaitFactor = 0.25;
+			AllowedZoneFactor = 2.0;
+			PreemptFactor = 0.75;
+			IpcDropFactor = 0.8;
+			DelayFactor = 0.15;
+			startTracking();
+			qDebug() << "loadcontrol: set system mode | tracking";
+			break;
+		}
+		default:
+			break;
 		};
 		return true;
 	}
 
 public slots:
-	void finishedTask(int ms) // processing signal "finished" of any task
+	void finishedTask(int ms, int cpu_ms) // processing signal "finished" of any task
 	{
 		if (IsRunning)
 		{
-			
+			Audit.sample(TaskAge * 1000000); // the latency counts the delivery from the worker too
+			TaskAge = 0;
 			if (changeThread(ms))
 			{
-				reset(-ThreadCount);
+				warmup();
 			}
 
 			// counting statistics
+			qreal cpu_ratio = (ms > 0) ? qMin((qreal)cpu_ms / ms, 1.0) : 1.0;
 			if (TaskCount < 0)
 			{
 				// waiting state
 				AvgTime = 0;
+				AvgCpuRatio = 0;
+				if (!warmupThread(ms)) TaskCount--; // keeps waiting till the task times settle
 			}
 			else if ((TaskCount == 0) && (AvgTime == 0))
 				{
 					// first counted task
 					AvgTime = ms;
+					AvgCpuRatio = cpu_ratio;
+					TaskStats.add(ms);
+					WindowClock.start();
 				}
 				else if (TaskCount > 0)
 				{
 					// making average statistics
 					AvgTime = ((AvgTime * TaskCount) + (qreal)ms) / (TaskCount + 1);
-					if (TaskCount > WAITCOUNT*SCALE) { setXTimeData(ThreadCount, AvgTime); reset(-1); }
+					AvgCpuRatio = ((AvgCpuRatio * TaskCount) + cpu_ratio) / (TaskCount + 1);
+					TaskStats.add(ms);
+					if (TaskCount > getWindowSize() && detectChange()) // the workload shifted -> the window is a mix of both, wait for a clean one
+					{
+						warmup();
+					}
+					else if (TaskCount > getWindowSize()) // statistics of the thread number are complete
+					{
+						TimeStats[ThreadCount - 1] = TaskStats;
+						setXTimeData(ThreadCount, AvgTime);
+						setIpcData(ThreadCount, AvgIpc);
+						setMissData(ThreadCount, getMissRate());
+						setSloData(ThreadCount, getTail());
+						setThroughputData(ThreadCount, getThroughput());
+						checkConvergence(WindowClock.elapsed() / 1000.0, getThroughput());
+						if (limitThread() || searchThread(getThroughput()) || banditThread(WindowClock.elapsed() / 1000.0, getThroughput()) || modelThread()) warmup();
+						else reset(-1);
+					}
 				}
 			TaskCount++;
 		}
 	};
 
+	void finishedInfo(TaskInfo task_info) // processing class and deadline of any task (comes before its "finished")
+	{
+		TaskAge = qMax(Clock->taskTime() - task_info.getFinishTime(), (qint64)0);
+		if (IsRunning && TaskCount >= 0 && task_info.hasDeadline())
+		{
+			DeadlineCount++;
+			if (task_info.isMissed()) MissCount++;
+		}
+		if (IsRunning && Mode == SystemSloMode)
+		{
+			qreal ms = (Metric == QueueSlo) ? task_info.getQueueTime() : task_info.getLatency();
+			SloTasks++;
+			if (ms <= SloTarget) SloMetTasks++;
+			if (TaskCount >= 0) SloHistogram.add(ms);
+		}
+		if (IsRunning && Mode == SystemTrackingMode && Tracked == QueueWaitTrack)
+		{
+			QueueWaitSum += task_info.getQueueTime();
+			QueueWaitCount++;
+		}
+	}
+
+	void setClock(ClockSource* clock) // sets what the control measures time with (before the start; a virtual clock is stepped with timeStep())
+	{
+		Clock = clock;
+		WarmupClock.setSource(clock);
+		WindowClock.setSource(clock);
+		TrackClock.setSource(clock);
+		ConvergeClock.setSource(clock);
+		ControlClock.setSource(clock);
+		ControlClock.start();
+		Audit.setSource(clock);
+		TrackTimer->stop();
+		NextTrackTime = -1;
+	}
+
+	void setSeed(quint32 seed) // makes the random choices repeat (bandit draws, back-off jitter)
+	{
+		Bandit.setSeed(seed);
+		Oscillation.setSeed(seed);
+	}
+
+	void timeStep() // runs the periodic work due at the virtual clock (the owner of the clock calls it after every event)
+	{
+		while (NextTrackTime >= 0 && Clock->msecs() >= NextTrackTime)
+		{
+			NextTrackTime += TrackPeriod;
+			trackThread();
+		}
+	}
+
+	void trackThread() // one step of the tracking loop (every sampling period)
+	{
+		if (!IsRunning || Mode != SystemTrackingMode)
+			return;
+		qreal measured = getTrackedValue();
+		qreal seconds = TrackClock.restart() / 1000.0;
+		if (measured < 0) // nothing to track yet
+			return;
+		Audit.sample();
+		Audit.cause(ControlDecision::TrackReason, measured, TrackTarget);
+		int next = Tracker.step(measured, seconds, ThreadCount, ThreadCeiling);
+		QueueWaitSum = 0;
+		QueueWaitCount = 0;
+		emit trackingSample(measured, TrackTarget, Tracker.steadyError());
+		if (next != ThreadCount)
+		{
+			jumpThread(next);
+			warmup();
+		}
+		else
+		{
+			Audit.decide(ThreadCount, ThreadCount);
+		}
+	}
+
 	bool overloadThread(int ms) // returns true if overload
 	{
-		if ((qreal)ms > (TaskTimeArray[ThreadCount - 1].y()))
+		if (Mode == SystemDeadlineMode) // deadlines instead of the completion time envelope
+			return missThread() || delayThread() || preemptThread();
+		else if (Mode == SystemSloMode) // tail latency target instead of the completion time envelope
+			return sloThread() || delayThread() || preemptThread();
+		else if (envelopeThread(ms))
+			return true;
+		else if (delayThread())
+			return true;
+		else if (preemptThread())
+			return true;
+		else return false;
+	}
+
+	bool envelopeThread(int ms) // returns true if the task times are significantly over the allowed zone (every task is a look -> strict z)
+	{
+		qreal envelope = TaskTimeArray[ThreadCount - 1].y();
+		if (TaskStats.count() < 2) // not enough for a variance -> only a task far out of the zone counts
+		{
+			if (ms > envelope * AllowedZoneFactor) Audit.cause(ControlDecision::OverloadReason, ms, envelope * AllowedZoneFactor, TaskStats.count());
+			return ms > envelope * AllowedZoneFactor;
+		}
+		else if (TaskStats.isAbove(envelope, TimeStats[ThreadCount - 1].error() * AllowedZoneFactor, TransitionZ))
+		{
+			qDebug() << "loadcontrol: envelope | mean" << TaskStats.mean() << "over" << envelope << "after" << TaskStats.count() << "tasks";
+			Audit.cause(ControlDecision::OverloadReason, TaskStats.mean(), envelope, TaskStats.count(), TaskStats.error());
+			return true;
+		}
+		else return false;
+	}
+
+	bool missThread() // returns true if more deadlines are missed than with one thread less
+	{
+		qreal miss_rate = getMissRate();
+		if (ThreadCount > 1 && miss_rate >= 0 && MissArray[ThreadCount - 2] >= 0 && miss_rate > MissArray[ThreadCount - 2] + MissMargin)
+		{
+			qDebug() << "loadcontrol: deadline misses |" << miss_rate << "against" << MissArray[ThreadCount - 2];
+			Audit.cause(ControlDecision::MissReason, miss_rate, MissArray[ThreadCount - 2] + MissMargin, DeadlineCount);
+			return true;
+		}
+		else return false;
+	}
+
+	bool sloThread() // returns true if the tail is over the target or one thread less met it with more throughput
+	{
+		qreal tail = getTail();
+		if (ThreadCount <= 1 || tail < 0)
+			return false;
+		else if (tail > SloTarget)
+		{
+			qDebug() << "loadcontrol: slo violation | p" << SloShare * 100 << tail << "ms over" << SloTarget;
+			Audit.cause(ControlDecision::SloReason, tail, SloTarget, SloHistogram.count());
+			return true;
+		}
+		else if (TailArray[ThreadCount - 2] >= 0 && TailArray[ThreadCount - 2] <= SloTarget && ThroughputArray[ThreadCount - 2] > getThroughput() * (1 + SloMargin))
+		{
+			qDebug() << "loadcontrol: slo throughput |" << ThroughputArray[ThreadCount - 2] << "tasks/sec with one thread less";
+			Audit.cause(ControlDecision::SloReason, getThroughput(), ThroughputArray[ThreadCount - 2] / (1 + SloMargin), TaskCount);
 			return true;
+		}
+		else return false;
+	}
+
+	bool delayThread() // returns true if workers spend too much time waiting in the run queue (too many runnable threads per core)
+	{
+		if (DelayCount > 0 && RunQueueDelay > DelayFactor)
+		{
+			qDebug() << "loadcontrol: run queue delay |" << RunQueueDelay;
+			Audit.cause(ControlDecision::DelayReason, RunQueueDelay, DelayFactor, DelayCount);
+			return true;
+		}
+		else return false;
+	}
+
+	void setPerfectThreadCount(int count) // sets the core budget (the per thread number data grows with it)
+	{
+		PerfectThreadCount = qMax(count, 1);
+		Audit.sample();
+		resizeProfile(PerfectThreadCount * OVERSUBSCRIPTION + 1); // one over the max thread number for the underload look ahead
+		ThreadLimit = PerfectThreadCount; // oversubscription is probed again for the new budget
+		HostCeiling = PerfectThreadCount;
+		updateCeiling();
+		emit threadLimitChanged(ThreadLimit);
+	}
+
+	void setPlacementPlan(QVector<PlaceKind> plan) // sets where every next thread lands (empty - no pinning)
+	{
+		PlacementPlan = plan;
+	}
+
+	void setThreadCeiling(int ceiling) // sets the number of cores the host can give now (lowered by co-located load)
+	{
+		HostCeiling = qBound(1, ceiling, PerfectThreadCount);
+		Audit.sample();
+		updateCeiling();
+	}
+
+	bool updateCeiling() // combines the host ceiling with the thread limit, returns true if threads over it were shed
+	{
+		ThreadCeiling = qBound(1, HostCeiling + ThreadLimit - PerfectThreadCount, ThreadLimit); // cores taken by other processes are taken off the oversubscription too
+		if (IsRunning && ThreadCount > ThreadCeiling)
+		{
+			qDebug() << "loadcontrol: host contention | ceiling" << ThreadCeiling;
+			if (!Audit.hasCause()) Audit.cause(ControlDecision::CeilingReason, ThreadCount, ThreadCeiling);
+			jumpThread(ThreadCeiling);
+			warmup();
+			return true;
+		}
+		else return false;
+	}
+
+	bool limitThread() // moves the thread limit over the budget while the threads block and back when they don't, returns true if threads were shed
+	{
+		if (AvgCpuRatio <= 0)
+			return false;
+		bool blocked = AvgCpuRatio < PreemptFactor // waiting for i/o or locks, not for a cpu
+			&& ((RunQueueDelay >= 0) ? RunQueueDelay < DelayFactor / 2 : AvgCpuRatio < PreemptFactor / 2); // no schedstat -> only a deep drop counts
+		int cap = PerfectThreadCount * OVERSUBSCRIPTION;
+		if (blocked && ThreadCount >= ThreadCeiling && ThreadLimit < cap)
+		{
+			ThreadLimit = qMin(ThreadLimit + qMax(PerfectThreadCount / 4, 1), cap);
+			qDebug() << "loadcontrol: threads block | cpu/wall ratio" << AvgCpuRatio << "limit" << ThreadLimit;
+			updateCeiling();
+			emit threadLimitChanged(ThreadLimit);
+			return false;
+		}
+		else if (!blocked && ThreadLimit > PerfectThreadCount && ThreadCount > PerfectThreadCount)
+		{
+			ThreadLimit = PerfectThreadCount;
+			qDebug() << "loadcontrol: threads don't block | cpu/wall ratio" << AvgCpuRatio << "limit" << ThreadLimit;
+			Audit.cause(ControlDecision::LimitReason, AvgCpuRatio, PreemptFactor, TaskCount);
+			emit threadLimitChanged(ThreadLimit);
+			return updateCeiling();
+		}
+		else return false;
+	}
+
+	int getThreadLimit() { return ThreadLimit; }
+	DecisionLog& getAudit() { return Audit; }
+
+	void setRunQueueDelay(qreal ms, qreal delay) // processing run queue wait of the workers (ms per sec and average share per worker)
+	{
+		Q_UNUSED(ms);
+		RunQueueDelay = delay;
+		DelayCount++;
+	}
+
+	void setProcessLoad(qreal own) // processing cores busy with the process (utilisation of the core budget)
+	{
+		ProcessLoad = own / qMax(PerfectThreadCount, 1);
+	}
+
+	void finishedCounters(qreal ipc) // processing hardware counters of any task (instructions per cycle)
+	{
+		if (IsRunning && TaskCount >= 0 && ipc > 0)
+		{
+			AvgIpc = ((AvgIpc * IpcCount) + ipc) / (IpcCount + 1);
+			IpcCount++;
+		}
+	}
+
+	bool saturateThread() // returns true if ipc fell down after the last thread was added (the cores are saturated)
+	{
+		if (ThreadCount > 1 && IpcArray[ThreadCount - 2] > 0 && IpcCount >= WAITCOUNT && AvgIpc < IpcDropFactor * IpcArray[ThreadCount - 2])
+		{
+			qDebug() << "loadcontrol: saturation | ipc" << AvgIpc << "against" << IpcArray[ThreadCount - 2];
+			Audit.cause(ControlDecision::SaturateReason, AvgIpc, IpcDropFactor * IpcArray[ThreadCount - 2], IpcCount);
+			return true;
+		}
+		else return false;
+	}
+
+	bool preemptThread() // returns true if tasks got longer because threads were descheduled (not because of contention)
+	{
+		if (TaskCount >= WAITCOUNT && AvgCpuRatio > 0 && AvgCpuRatio < PreemptFactor
+			&& (RunQueueDelay < 0 || RunQueueDelay >= DelayFactor / 2)) // without run queue delay the threads are blocked, not preempted
+		{
+			qDebug() << "loadcontrol: preemption | cpu/wall ratio" << AvgCpuRatio;
+			Audit.cause(ControlDecision::PreemptReason, AvgCpuRatio, PreemptFactor, TaskCount);
+			return true;
+		}
 		else return false;
 	}
 
 	bool underloadThread() // returns true if underload
 	{
-		if (((TaskTimeArray[ThreadCount].x() != 0) && (TaskTimeArray[ThreadCount - 1].x() != 0)) || (TaskCount >= WAITCOUNT) && (ThreadCount < PerfectThreadCount + OVERLOAD))
+		if (ThreadCount >= ThreadCeiling) // host is contended
 		{
-			if (AvgTime > 0 && AvgTime < TaskTimeArray[ThreadCount - 1].x() + WaitFactor * (TaskTimeArray[ThreadCount - 1].y() - TaskTimeArray[ThreadCount - 1].x()))
+			Audit.cause(ControlDecision::CeilingReason, ThreadCount, ThreadCeiling);
+			return false;
+		}
+		else if (((TaskTimeArray[ThreadCount].x() != 0) && (TaskTimeArray[ThreadCount - 1].x() != 0)) || (TaskCount >= WAITCOUNT) && (ThreadCount < ThreadLimit))
+		{
+			qreal wait_factor = WaitFactor;
+			if (ThreadCount < PlacementPlan.count() && PlacementPlan[ThreadCount] == SiblingPlace) // next thread is a hyperthread -> it gives less, so ask for a better time
+				wait_factor *= SiblingFactor;
+			else if (ThreadCount < PlacementPlan.count() && PlacementPlan[ThreadCount] == SpillPlace) // next thread opens a remote node -> grow the current node out first
+				wait_factor *= SpillFactor;
+			if (saturateThread())
+				return false;
+			else if (Mode == SystemDeadlineMode) // grow only while deadlines are missed and the next thread number isn't known to miss more
+			{
+				qreal miss_rate = getMissRate();
+				bool grow = miss_rate > 0 && (MissArray[ThreadCount] < 0 || MissArray[ThreadCount] < miss_rate - MissMargin);
+				Audit.cause(grow ? ControlDecision::UnderloadReason : ControlDecision::WaitReason, miss_rate, qMax(MissArray[ThreadCount], 0.0) + MissMargin, DeadlineCount);
+				return grow;
+			}
+			else if (Mode == SystemSloMode) // grow while the target is met and the next thread number is unknown or known to give more within the target
+			{
+				qreal tail = getTail();
+				bool grow = tail >= 0 && tail <= SloTarget
+					&& (TailArray[ThreadCount] < 0 || (TailArray[ThreadCount] <= SloTarget && ThroughputArray[ThreadCount] > getThroughput() * (1 + SloMargin)));
+				Audit.cause(grow ? ControlDecision::UnderloadReason : ControlDecision::WaitReason, tail, SloTarget, SloHistogram.count());
+				return grow;
+			}
+			qreal stand_by = TaskTimeArray[ThreadCount - 1].x() + wait_factor * (TaskTimeArray[ThreadCount - 1].y() - TaskTimeArray[ThreadCount - 1].x());
+			if (AvgTime > 0 && TaskStats.isBelow(stand_by, TimeStats[ThreadCount - 1].error() * (1 + wait_factor * (AllowedZoneFactor - 1)), TransitionZ)) // significantly below the stand by zone
+			{
+				Audit.cause(ControlDecision::UnderloadReason, TaskStats.mean(), stand_by, TaskStats.count(), TaskStats.error());
 				return true;
+			}
 			else
 			{
 				qDebug() << "loadcontrol: wait condition";
+				Audit.cause(ControlDecision::WaitReason, TaskStats.mean(), stand_by, TaskStats.count(), TaskStats.error());
 				return false;
 			}
 		}
@@ -350,44 +1288,73 @@ public slots:
 	bool changeThread(int ms) // returns true if there was a change in running thread number 
 	{
 		if (TaskTimeArray[ThreadCount - 1].x() == 0) // wait condition (no information about this state)
+		{
+			Audit.decide(ThreadCount, ThreadCount, ControlDecision::WaitReason);
+			return false;
+		}
+		else if (Mode == SystemSearchMode && !Search.isOver()) // the search moves the thread number at the window ends
 		{
 			return false;
 		}
+		else if (Mode == SystemBanditMode) // the bandit picks the thread number at the window ends (no up lock back-off needed)
+		{
+			return false;
+		}
+		else if (Mode == SystemTrackingMode) // the tracking loop steps on its own period
+		{
+			return false;
+		}
+		else if (ThreadCount > 1 && Oscillation.isLocked(-1, ControlClock.elapsed())) // the overload rules would fire (and log) on every task of the lock
+		{
+			Audit.decide(ThreadCount, ThreadCount, ControlDecision::DownLockReason);
+			return false; // down-state transition is backing off a cycle, the thread number holds
+		}
 		else if (overloadThread(ms))
 		{	
 			if (ThreadCount > 1)
 			{
 				//setXTimeData(ThreadCount, AvgTime);
+				Audit.decide(ThreadCount, ThreadCount - 1);
 				emit removeThread(ms);
 				return true;
 			}
 			else
 			{
+				Audit.decide(ThreadCount, ThreadCount);
 				return false; // wait condition (lowest thread number)
 			}
 		}
 		else if (underloadThread())
 		{
-			if (UpLock)
+			if (Oscillation.isLocked(1, ControlClock.elapsed()))
 			{
 				//qDebug() << "load system: unable to complete action | up-state transition is locked";
-				return false; // up-state transition is locked
+				Audit.decide(ThreadCount, ThreadCount, ControlDecision::UpLockReason);
+				return false; // up-state transition is backing off a cycle
 			}
-				else
+			else
 			{
 				//setXTimeData(ThreadCount, AvgTime);
+				Audit.decide(ThreadCount, ThreadCount + 1);
 				emit addThread();
 				return true;
 			}
 		}
 		else
 		{
+			Audit.decide(ThreadCount, ThreadCount);
 			return false; // wait condition (counting statistics)
 		}
 	};
 
 	void setThreadCount(int count)
 	{
+		if (count != ThreadCount)
+		{
+			StableCount = 0;
+			if (ConvergeClock.isValid()) ChangeTime = ConvergeClock.elapsed() / 1000.0;
+			Audit.applied(count);
+		}
 		ThreadCount = count;
 	}
 
@@ -397,37 +1364,151 @@ public slots:
 		if (ms.y() != 0) setYTimeData(i, ms.y());
 	}
 
-	void unlockUp()
-	{ 
-		UpLock = false;
-		qDebug() << "loadcontrol: unlock up";
-	}
-
 private:
-	int TaskCount = 0; // number of completed tasks in the relax state
+	int TaskCount = 0; // number of completed tasks in the relax state (below zero while waiting)
+	WarmupDetector Warmup; // settling of the task times after a thread change
+	ClockTimer WarmupClock; // time since the thread change
+	bool Warming = false; // waiting for the warm-up to end
 	int WaitCount = 0; // number of completed tasks to wait to change thread number
 	int ThreadCount = 0; // current thread number
 	qreal AvgTime = 0; // average task completion time at the same thread number
+	qreal AvgCpuRatio = 0; // average cpu to wall time ratio of the tasks at the same thread number
+	RunningStats TaskStats; // mean and variance of the task times at the same thread number
+	qreal AvgIpc = 0; // average instructions per cycle of the tasks at the same thread number
+	int IpcCount = 0; // number of tasks with hardware counters in AvgIpc
+	qreal RunQueueDelay = -1; // last average share of time the workers were waiting for a cpu (-1 if unknown)
+	int DelayCount = 0; // number of run queue delay samples at the same thread number
+	int DeadlineCount = 0; // number of tasks with deadlines at the same thread number
+	int MissCount = 0; // number of them finished after the deadline
+	SystemMode Mode = SystemLightMode;
+	SloMetric Metric = CompletionSlo;
+	qreal SloTarget = 1000.0; // ms the slo percentile must stay within
+	qreal SloShare = 0.99; // slo percentile (0.99 - p99)
+	TimeHistogram SloHistogram; // slo metric of the tasks at the same thread number
+	ClockTimer WindowClock; // wall time since the first counted task at the same thread number
+	quint64 SloTasks = 0; // tasks measured in the slo mode since start
+	quint64 SloMetTasks = 0; // the ones within the target
+	UslModel Model; // scalability model of the measured throughput
+	int ModelTarget = 0; // last thread number jumped to by the model
+	const int ModelJump = 2; // min distance to the predicted peak worth a jump
+	GoldenSearch Search; // probes of the search mode
+	ThreadBandit Bandit; // arms of the bandit mode
+	ThreadBandit::BanditRule Rule = ThreadBandit::ThompsonRule;
+	qreal OracleThroughput = 0; // tasks/sec of the best thread number measured offline
+	qreal Regret = 0; // tasks lost against the oracle since the start of the bandit mode
+	qreal RegretTime = 0; // sec of the windows counted in the regret
+	TrackingController Tracker; // feedback loop of the tracking mode
+	TrackMetric Tracked = UtilisationTrack;
+	TrackingController::TrackingRule TrackRule = TrackingController::PidRule;
+	qreal TrackTarget = 0.8; // value the tracking mode holds (share or ms)
+	int TrackPeriod = 1000; // ms between the tracking steps
+	QTimer* TrackTimer = nullptr; // tracking sampling period
+	qint64 NextTrackTime = -1; // ms of the virtual clock the next tracking step is due at (-1 - none)
+	ClockTimer TrackClock; // time since the last tracking step
+	qreal ProcessLoad = -1; // last share of the core budget busy with the process (-1 if unknown)
+	qreal QueueWaitSum = 0; // ms of queueing of the tasks finished since the last tracking step
+	int QueueWaitCount = 0;
+	ClockTimer ConvergeClock; // time since start
+	QVector<QPointF> ConvergeWindows; // duration (sec) and throughput of the windows till convergence
+	qreal ChangeTime = 0; // sec since start of the last thread change
+	int StableCount = 0; // windows since the last thread change
+	bool Converged = false;
+	int SloWindows = 0; // completed windows in the slo mode since start
+	int SloMetWindows = 0; // the ones with the percentile within the target
 	bool IsRunning = false; // 
 	bool IsStopped = false; // current managing system state
-	const int PerfectThreadCount; // const IdealThreadCount
+	int PerfectThreadCount; // core budget of the process
+	int ThreadCeiling; // max thread number the control may use now (limit less the cores taken by the host)
+	int HostCeiling; // cores of the budget the host can give now
+	int ThreadLimit; // max thread number over the budget the blocking threads were allowed (budget if they don't block)
 	qreal WaitFactor; // underload to stand by ratio
 	qreal AllowedZoneFactor; // upper to lower allowed zone ratio
-	QPointF TaskTimeArray[DATADEPTH]; // average data for each thread number, x means the lowest and y the biggest possible time scales
-
-	bool UpLock = false; // locks the up-state transition (underload condition)
-	QTimer* UpLockTimer; // measures UpLock interval
-	quint16 SystemState = 0; // transition set bit flag (last 16 transitions)
-	uint UpLockCount = 0; // number of locks in current state
+	qreal PreemptFactor; // cpu to wall time ratio below which threads are considered oversubscribed
+	qreal IpcDropFactor; // ipc ratio (current to previous thread number) below which cores are considered saturated
+	qreal DelayFactor; // run queue wait share above which threads are considered oversubscribed
+	const qreal MissMargin = 0.02; // deadline miss rate difference treated as noise
+	const qreal SloMargin = 0.05; // throughput gain treated as noise in the slo mode
+	const qreal TransitionZ = 2.33; // one-sided z of the transition tests (1% per look)
+	const qreal WindowZ = 1.96; // confidence of the window mean
+	const qreal WindowPrecision = 0.05; // relative error of the window mean the window size is chosen for
+	const qreal SiblingFactor = 0.5; // wait factor multiplier for growing onto an SMT sibling
+	const qreal SpillFactor = 0.25; // wait factor multiplier for spilling onto the next numa node
+	QVector<PlaceKind> PlacementPlan; // place of every slot (thread number - 1)
+	QVector<QPointF> TaskTimeArray; // average data for each thread number, x means the lowest and y the biggest possible time scales
+	QVector<qreal> IpcArray; // average instructions per cycle for each thread number (0 if unknown)
+	QVector<qreal> MissArray; // average deadline miss rate for each thread number (-1 if unknown)
+	QVector<qreal> TailArray; // average slo percentile (ms) for each thread number (-1 if unknown)
+	QVector<qreal> ThroughputArray; // average tasks per second for each thread number (0 if unknown)
+	ChangeDetector TimeDetector; // level of the window task time relative to the learned one
+	ChangeDetector ThroughputDetector; // level of the window throughput relative to the learned one
+	QVector<RunningStats> TimeStats; // task time mean and variance of the last complete window for each thread number
+	DecisionLog Audit; // last decisions with their reasons, inputs and thresholds
+	qint64 TaskAge = 0; // ms since the last task finished in its worker (queued delivery to the control)
+
+	OscillationDetector Oscillation; // limit cycles of the thread number and back-off of their steps
+	ClockTimer ControlClock; // time base of the back-off
+	ClockSource* Clock = ClockSource::system(); // time of all the timers (virtual in the simulator)
+	qint64 ChangeClockTime = 0; // ms of the control clock at the last thread change
 
 signals:
 	void addThread();
 	void removeThread(qreal ms);
 	void timeDataChanged(int count, QPointF ms);
+	void modelChanged(UslModel model);
+	void searchFinished(int count, int probes);
+	void converged(qreal sec, int windows, qreal lost);
+	void trackingSample(qreal measured, qreal target, qreal error); // tracked value, its target and steady state error of one tracking step
+	void warmedUp(int count, int tasks, qint64 ms); // task times at the thread number settled after that many tasks and ms
+	void workloadChanged(QString shift); // the learned profile was dropped
+	void oscillated(int period, int direction, qint64 ms, qreal lost); // a limit cycle of 'period' changes locked the direction for ms (tasks lost to the cycles so far)
+	void threadLimitChanged(int limit); // max thread number the control may go to now
 
 };
 
 
+// TASK QUEUE CLASS - backlog of one workload class dispatched by deficit round robin
+// (closed loop: there are no arrivals, the backlog is topped up to a fixed depth when a task is taken, so the queueing time of a task
+// is the time the class took to dispatch the tasks ahead of it - queue metrics model this fixed backlog, not an open arrival stream)
+
+class TaskQueue
+{
+
+public:
+	TaskQueue(QString name = "default", int weight = 1, int range = SEARCH_RANGE, int deadline = 0)
+		: Name(name), Weight(qMax(weight, 1)), Range(qMax(range, 1)), Deadline(qMax(deadline, 0)) {}
+
+	QString& getName() { return Name; }
+	int getWeight() { return Weight; } // share of work time of the class (in standard tasks per round)
+	int getRange() { return Range; }
+	int getDeadline() { return Deadline; } // ms after enqueue the task must finish by (0 - no deadline)
+	qreal& getDeficit() { return Deficit; }
+	qreal getCost(ThreadTask::WorkType type) // work of one task relative to the standard task
+	{
+		qreal ratio = (qreal)Range / SEARCH_RANGE;
+		return (type == ThreadTask::CycleWork || type == ThreadTask::IoWork) ? ratio * ratio : ratio;
+	}
+	qint64 takeTask(int depth) // takes the oldest task's enqueue time (the backlog is kept 'depth' tasks long, new ones are stamped when they join it)
+	{
+		peekTask(depth);
+		return Backlog.takeFirst();
+	}
+	qint64 peekTask(int depth) // returns the oldest task's enqueue time without taking it
+	{
+		while (Backlog.count() < qMax(depth, 1)) Backlog.append(TaskInfo::now());
+		return Backlog.first();
+	}
+	void clear() { Backlog.clear(); Deficit = 0.0; }
+
+private:
+	QString Name;
+	int Weight;
+	int Range;
+	int Deadline; // ms, relative to enqueue
+	qreal Deficit = 0.0; // work the class may still dispatch in the current round
+	QList<qint64> Backlog; // enqueue times of the waiting tasks
+};
+
+
 // TASK MANAGER CLASS - class for instant thread pool managing 
 
 class TaskManager : public QObject
@@ -438,29 +1519,103 @@ public:
 	TaskManager(int count) : PerfectThreadCount(count)
 	{ 
 		setMaxThreadNumber(1);
+		TaskQueues.append(TaskQueue());
 	}
+	enum DispatchMode { FairDispatch, DeadlineDispatch }; // deficit round robin or earliest deadline first
 	inline void startThreads(int ThreadNumber); // starts tasks executing by ThreadNumber similar threads
 	inline void addThread(); // adds one more thread to do executing tasks
 	inline void removeThread(); // removes one thread from running thread pool
 	void setCurrentThreadNumber(int num) { CurrentThreadNumber = num; } // sets up the number of running threads
 	inline void setMaxThreadNumber(int num);
 	void stopThreads() { setMaxThreadNumber(0); MyThreadPool.clear(); } // stops all running threads and deletes all tasks
+	void setCountersEnabled(bool enabled) { CountersEnabled = enabled; } // new tasks read per thread perf counters
+	void setPerfectThreadCount(int count) { PerfectThreadCount = count; } // sets the core budget
+	void setPlacementEnabled(bool enabled) { Placement.setEnabled(enabled); } // pins new tasks to the topology places
+	void setWorkType(ThreadTask::WorkType type) { TaskWorkType = type; } // type of work for new tasks
+	ThreadTask::WorkType getWorkType() { return TaskWorkType; }
+	void setSchedPolicy(SchedPolicy policy) { TaskPolicy = policy; } // scheduling class for new tasks
+	inline void setTaskQueues(QList<TaskQueue> queues); // sets workload classes sharing the threads
+	QList<TaskQueue>& getTaskQueues() { return TaskQueues; }
+	void setDispatchMode(DispatchMode mode) { Dispatch = mode; }
+	WorkerPlacement& getPlacement() { return Placement; }
 
 public slots:
-	void addTask(); // creates new ThreadTask to execute and adds it to running thread pool
-	void finishTask(ThreadState thread_state);
+	void addTask(); // creates new ThreadTask of the next class queue and adds it to running thread pool
+	void finishTask(ThreadState thread_state, TaskInfo task_info);
 
 private:
 	int CurrentThreadNumber = 1;
-	const int PerfectThreadCount; // const IdealThreadCount
+	int PerfectThreadCount; // core budget of the process
 	quint64 TaskCount = 0;
 	QThreadPool MyThreadPool;
+	bool CountersEnabled = false;
+	WorkerPlacement Placement;
+	ThreadTask::WorkType TaskWorkType = ThreadTask::CycleWork;
+	SchedPolicy TaskPolicy;
+	QList<TaskQueue> TaskQueues; // workload classes
+	int QueueRound = 0; // class queue visited by deficit round robin
+	int TasksInPool = 0; // dispatched tasks not finished yet
+	DispatchMode Dispatch = FairDispatch;
+
+	inline int nextQueue(); // deficit round robin choice of the class queue
+	inline int earliestQueue(); // earliest deadline first choice of the class queue
+	inline qint64 headDeadline(int queue); // absolute deadline of the oldest task in the class queue
+	inline void dispatch(); // keeps one task waiting in the pool over the running threads
 
 signals:
-	void finishTime(int ms);
+	void finishTime(int ms, int cpu_ms); // times normalized to the standard task
+	void finishCounters(qreal ipc);
 	void finishThread(ThreadState thread_state);
+	void finishInfo(TaskInfo task_info);
 };
 
+void TaskManager::setTaskQueues(QList<TaskQueue> queues)
+{
+	if (!queues.isEmpty())
+	{
+		TaskQueues = queues;
+		QueueRound = 0;
+	}
+}
+
+int TaskManager::earliestQueue()
+{
+	int earliest = 0;
+	for (int queue = 1; queue < TaskQueues.count(); queue++)
+	{
+		if (headDeadline(queue) < headDeadline(earliest)) earliest = queue;
+	}
+	return earliest;
+}
+
+qint64 TaskManager::headDeadline(int queue)
+{
+	int deadline = TaskQueues[queue].getDeadline();
+	if (deadline == 0) // no deadline -> the loosest deadline of the classes (so that best effort work isn't starved)
+	{
+		foreach (TaskQueue task_queue, TaskQueues) deadline = qMax(deadline, task_queue.getDeadline());
+	}
+	return TaskQueues[queue].peekTask(PerfectThreadCount * OVERSUBSCRIPTION + 1) + deadline;
+}
+
+int TaskManager::nextQueue()
+{
+	if (Dispatch == DeadlineDispatch)
+		return earliestQueue();
+	forever
+	{
+		TaskQueue& task_queue = TaskQueues[QueueRound];
+		qreal cost = task_queue.getCost(TaskWorkType);
+		if (task_queue.getDeficit() >= cost)
+		{
+			task_queue.getDeficit() -= cost;
+			return QueueRound;
+		}
+		QueueRound = (QueueRound + 1) % TaskQueues.count();
+		TaskQueues[QueueRound].getDeficit() += TaskQueues[QueueRound].getWeight(); // backlogs are never empty -> every visit adds the quantum
+	}
+}
+
 
 // LOAD CHARTVIEW CLASS - class for load/performance chart data and visualization settings
 
@@ -483,15 +1638,15 @@ public:
 		TimeAxis->setTitleText("Time, sec");
 
 		LoadAxis = new QValueAxis;
-		LoadAxis->setRange(0, PerfectThreadCount + OVERLOAD + 2);
-		LoadAxis->setTickCount((PerfectThreadCount + OVERLOAD + 2) / 2 + 1);
+		LoadAxis->setRange(0, PerfectThreadCount + 2);
+		LoadAxis->setTickCount((PerfectThreadCount + 2) / 2 + 1);
 		LoadAxis->setMinorTickCount(1);
 		LoadAxis->setLabelFormat("%i");
 		LoadAxis->setTitleText("Threads, num");
 
 		PerformanceAxis = new QValueAxis;
 		PerformanceAxis->setRange(0.0, 1.0);
-		PerformanceAxis->setTickCount((PerfectThreadCount + OVERLOAD + 2) / 2 + 1);
+		PerformanceAxis->setTickCount((PerfectThreadCount + 2) / 2 + 1);
 		PerformanceAxis->setMinorTickCount(1);
 		PerformanceAxis->setTitleText("Performance, tasks/sec");
 
@@ -547,6 +1702,12 @@ public:
 		HelpMenu->addAction("Save Chart", this, &LoadChartView::saveChart, Qt::CTRL + Qt::Key_S);
 		setStyleSheet("QMenu::separator { height: 1px; background: rgb(100, 100, 100); margin-left: 5px; margin-right: 5px; }");
 	};
+	void setThreadRange(int count) // resizes load axis for the new max thread number
+	{
+		LoadAxis->setRange(0, count + 2);
+		LoadAxis->setTickCount((count + 2) / 2 + 1);
+		chart()->update();
+	}
 	int getLastLoadPoint() // returns load value of last added load series point
 	{
 		return LastLoadPoint;
@@ -588,6 +1749,14 @@ private:
 	QValueAxis* PerformanceAxis;
 	QLineSeries* LoadSeries;
 	QLineSeries* PerformanceSeries;
+	QList<QLineSeries*> NodeSeries; // performance of every numa node
+	QValueAxis* LatencyAxis = 0; // created with the first class point
+	QList<QLineSeries*> ClassSeries; // performance of every workload class
+	QList<QLineSeries*> ClassLatencySeries; // mean latency of every workload class
+	QValueAxis* TrackingAxis = 0; // created with the first tracking point
+	QLineSeries* TrackingSeries; // tracked value
+	QLineSeries* TrackingTargetSeries;
+	QLineSeries* TrackingErrorSeries; // steady state error
 	QTimer* ChartUpdateTimer;
 	QTime TimeLine;
 	int PerformanceScaleNumber = 0;
@@ -715,6 +1884,92 @@ public slots:
 		resizePerformanceAxis(performance);
 		//qDebug() << "loadchartview: performance point |" << performance;
 	}
+	void addNodePerformancePoint(int node, qreal performance) // puts new performance point of the numa node (series is created with the first point)
+	{
+		while (NodeSeries.count() <= node)
+		{
+			QLineSeries* node_series = new QLineSeries;
+			node_series->setName("Node " + QString::number(NodeSeries.count()));
+			chart()->addSeries(node_series);
+			node_series->attachAxis(TimeAxis);
+			node_series->attachAxis(PerformanceAxis);
+			NodeSeries.append(node_series);
+		}
+		qreal time = TimeLine.elapsed() / 1000;
+		NodeSeries[node]->append(time, performance);
+	}
+	void addClassPerformancePoint(int class_id, QString name, qreal performance, qreal latency) // puts new performance and latency points of the workload class
+	{
+		if (LatencyAxis == 0)
+		{
+			LatencyAxis = new QValueAxis;
+			LatencyAxis->setRange(0.0, 1.0);
+			LatencyAxis->setLabelFormat("%i");
+			LatencyAxis->setTitleText("Latency, ms");
+			chart()->addAxis(LatencyAxis, Qt::AlignRight);
+		}
+		while (ClassSeries.count() <= class_id)
+		{
+			QLineSeries* class_series = new QLineSeries;
+			chart()->addSeries(class_series);
+			class_series->attachAxis(TimeAxis);
+			class_series->attachAxis(PerformanceAxis);
+			ClassSeries.append(class_series);
+
+			QLineSeries* latency_series = new QLineSeries;
+			chart()->addSeries(latency_series);
+			latency_series->attachAxis(TimeAxis);
+			latency_series->attachAxis(LatencyAxis);
+			QPen pen = latency_series->pen();
+			pen.setStyle(Qt::DashLine);
+			latency_series->setPen(pen);
+			ClassLatencySeries.append(latency_series);
+		}
+		if (ClassSeries[class_id]->name() != name)
+		{
+			ClassSeries[class_id]->setName(name);
+			ClassLatencySeries[class_id]->setName(name + " latency");
+		}
+		qreal time = TimeLine.elapsed() / 1000;
+		ClassSeries[class_id]->append(time, performance);
+		ClassLatencySeries[class_id]->append(time, latency);
+		if (latency * 1.25 > LatencyAxis->max()) LatencyAxis->setMax(ceil(latency * 1.5));
+	}
+	void addTrackingPoint(qreal measured, qreal target, qreal error) // puts new points of the tracked value, its target and steady state error (step response)
+	{
+		if (TrackingAxis == 0)
+		{
+			TrackingAxis = new QValueAxis;
+			TrackingAxis->setRange(0.0, 1.0);
+			TrackingAxis->setTitleText("Tracked");
+			chart()->addAxis(TrackingAxis, Qt::AlignRight);
+			TrackingSeries = new QLineSeries;
+			TrackingSeries->setName("Tracked");
+			TrackingTargetSeries = new QLineSeries;
+			TrackingTargetSeries->setName("Target");
+			TrackingErrorSeries = new QLineSeries;
+			TrackingErrorSeries->setName("Steady Error");
+			foreach (QLineSeries* series, QList<QLineSeries*>() << TrackingSeries << TrackingTargetSeries << TrackingErrorSeries)
+			{
+				chart()->addSeries(series);
+				series->attachAxis(TimeAxis);
+				series->attachAxis(TrackingAxis);
+			}
+			QPen pen = TrackingTargetSeries->pen();
+			pen.setStyle(Qt::DashLine);
+			TrackingTargetSeries->setPen(pen);
+			pen = TrackingErrorSeries->pen();
+			pen.setStyle(Qt::DotLine);
+			TrackingErrorSeries->setPen(pen);
+		}
+		qreal time = TimeLine.elapsed() / 1000;
+		TrackingSeries->append(time, measured);
+		TrackingTargetSeries->append(time, target);
+		TrackingErrorSeries->append(time, error);
+		qreal top = qMax(measured, target) * 1.25;
+		if (top > TrackingAxis->max()) TrackingAxis->setMax(top);
+		if (error < TrackingAxis->min()) TrackingAxis->setMin(error * 1.25);
+	}
 	void scrollTimeAxis(qreal dtime)
 	{
 		if (TimeAxis->min() + dtime >= 0)
@@ -744,6 +1999,8 @@ signals:
 
 // STAR CHARTVIEW CLASS - class for load system time data and visualization settings
 
+#define STARTICKS 24 // max number of angle ticks (more thread numbers share a tick, point labels are hidden)
+
 class StarChartView : public QChartView
 {
 	Q_OBJECT
@@ -768,8 +2025,7 @@ public:
 		RadialAxis->setTitleText("Time, msec");
 
 		AngleAxis = new QValueAxis;
-		AngleAxis->setRange(1, AngleTickNumber + 1);
-		AngleAxis->setTickCount(AngleTickNumber + 1);
+		setAngleTicks();
 		AngleAxis->setLabelFormat("%i");
 		AngleAxis->setTitleText("Threads");
 
@@ -778,7 +2034,7 @@ public:
 		for (int i = 0; i < AngleTickNumber + 1; i++) { LowerScaleSeries->append(i + 1, 0.0); UpperScaleSeries->append(i + 1, 0.0); }
 
 		ScaleSeries = new QAreaSeries(UpperScaleSeries, LowerScaleSeries);
-		ScaleSeries->setPointLabelsVisible(true);
+		ScaleSeries->setPointLabelsVisible(AngleTickNumber <= STARTICKS); // hundreds of labels would cover the chart
 		ScaleSeries->setPointLabelsClipping(false);
 		ScaleSeries->setPointLabelsFormat("@yPoint");
 		ScaleSeries->setName("Time Scale");
@@ -791,6 +2047,18 @@ public:
 		OverloadSeries->setMarkerShape(QScatterSeries::MarkerShapeCircle);
 		OverloadSeries->setMarkerSize(7.5);
 
+		ModelSeries = new QLineSeries;
+		ModelSeries->setName("USL Fit");
+		ModelUpperSeries = new QLineSeries;
+		ModelLowerSeries = new QLineSeries;
+		ModelBandSeries = new QAreaSeries(ModelUpperSeries, ModelLowerSeries);
+		ModelBandSeries->setName("USL Band");
+
+		PeakSeries = new QScatterSeries();
+		PeakSeries->setName("USL Peak");
+		PeakSeries->setMarkerShape(QScatterSeries::MarkerShapeRectangle);
+		PeakSeries->setMarkerSize(10.0);
+
 		connect(ScaleSeries, &QAreaSeries::pressed, this, &StarChartView::pressedPoint);
 		//connect(ScaleSeries, &QAreaSeries::released, this, &StarChartView::releasedPoint);
 		connect(OverloadSeries, &QScatterSeries::pressed, this, &StarChartView::pressedPoint);
@@ -807,12 +2075,29 @@ public:
 		OverloadSeries->attachAxis(RadialAxis);
 		OverloadSeries->attachAxis(AngleAxis);
 
+		chart->addSeries(this->ModelBandSeries);
+		ModelBandSeries->attachAxis(RadialAxis);
+		ModelBandSeries->attachAxis(AngleAxis);
+
+		chart->addSeries(this->ModelSeries);
+		ModelSeries->attachAxis(RadialAxis);
+		ModelSeries->attachAxis(AngleAxis);
+
+		chart->addSeries(this->PeakSeries);
+		PeakSeries->attachAxis(RadialAxis);
+		PeakSeries->attachAxis(AngleAxis);
+
 		//chart widget setting
 		setChart(chart);
-		setRenderHint(QPainter::Antialiasing);
+		setRenderHint(QPainter::Antialiasing, AngleTickNumber <= STARTICKS * 4); // big hosts -> cheaper drawing
 		update();
 
 		ScaleSeries->setBorderColor(ScaleSeries->color());
+		QColor band = ModelSeries->color();
+		band.setAlphaF(0.25);
+		ModelBandSeries->setColor(band);
+		ModelBandSeries->setBorderColor(band);
+		PeakSeries->setColor(ModelSeries->color());
 
 		//help menu settings
 		HelpMenu = new QMenu(this);
@@ -823,6 +2108,25 @@ public:
 		HelpMenu->addAction("Save Chart", this, &StarChartView::saveChart, Qt::CTRL + Qt::Key_S);
 		setStyleSheet("QMenu::separator { height: 1px; background: rgb(100, 100, 100); margin-left: 5px; margin-right: 5px; }");
 	};
+	void setThreadRange(int count) // rebuilds the time scale for the new max thread number, kept ticks keep their points
+	{
+		if (count < 1 || count == AngleTickNumber) return;
+		QVector<QPointF> upper = UpperScaleSeries->pointsVector();
+		QVector<QPointF> lower;
+		upper.resize(count + 1);
+		for (int i = 0; i < count + 1; i++)
+		{
+			if (i > AngleTickNumber) upper[i] = QPointF(i + 1, 0.0);
+			lower.append(QPointF(i + 1, 0.0));
+		}
+		AngleTickNumber = count;
+		setAngleTicks();
+		LowerScaleSeries->replace(lower);
+		UpperScaleSeries->replace(upper);
+		ScaleSeries->setPointLabelsVisible(AngleTickNumber <= STARTICKS);
+		setRenderHint(QPainter::Antialiasing, AngleTickNumber <= STARTICKS * 4);
+		chart()->update();
+	}
 	bool resizeRadialRange(qreal point, qreal scale = 1.5)
 	{
 		chart()->update();
@@ -877,6 +2181,19 @@ public:
 	{
 		OverloadSeries->clear();
 	}
+	void clearScale() // drops the time scale and the model (the profile they show is gone)
+	{
+		QVector<QPointF> points;
+		for (int i = 0; i < AngleTickNumber + 1; i++) points.append(QPointF(i + 1, 0.0));
+		LowerScaleSeries->replace(points); // one repaint for all ticks
+		UpperScaleSeries->replace(points);
+		ModelSeries->clear();
+		ModelUpperSeries->clear();
+		ModelLowerSeries->clear();
+		PeakSeries->clear();
+		clearOverloadSeries();
+		chart()->update();
+	}
 	void zoomChartIn()
 	{
 		qreal scale = RadialAxis->max() * 0.8;
@@ -903,12 +2220,24 @@ private:
 	QLineSeries* UpperScaleSeries;
 	QAreaSeries* ScaleSeries;
 	QScatterSeries* OverloadSeries;
+	QLineSeries* ModelSeries; // task time of the fitted scalability model
+	QLineSeries* ModelUpperSeries;
+	QLineSeries* ModelLowerSeries;
+	QAreaSeries* ModelBandSeries; // ~95% band of the model task time
+	QScatterSeries* PeakSeries; // thread number of the predicted throughput peak
 	QValueAxis* RadialAxis;
 	QValueAxis* AngleAxis;
 	QPoint ScreenPoint = QPoint(0,0);
 	QPointF ChartPoint = QPointF(0.0, 0.0);
 	int RadialScaleNumber = 0;
-	const int AngleTickNumber;
+	int AngleTickNumber; // max thread number on the angle axis
+	void setAngleTicks() // at most STARTICKS labelled ticks on the angle axis
+	{
+		int tick_step = (AngleTickNumber + STARTICKS - 1) / STARTICKS; // thread numbers per angle tick
+		int tick_intervals = (AngleTickNumber + tick_step - 1) / tick_step;
+		AngleAxis->setRange(1, 1 + tick_step * tick_intervals);
+		AngleAxis->setTickCount(tick_intervals + 1);
+	}
 
 protected:
 	void keyPressEvent(QKeyEvent* event)
@@ -975,6 +2304,24 @@ public slots:
 			resizeRadialRange(point.y());
 		}
 	}
+	void setModel(UslModel model) // draws the scalability model as task time of every thread number (N / X(N))
+	{
+		ModelSeries->clear();
+		ModelUpperSeries->clear();
+		ModelLowerSeries->clear();
+		PeakSeries->clear();
+		for (qreal n = 1.0; n <= AngleTickNumber + 1; n += qMax(0.25, AngleTickNumber / 100.0)) // at most ~400 points on big hosts
+		{
+			qreal time = model.taskTime(n);
+			qreal interval = model.taskTimeInterval(n);
+			ModelSeries->append(n, time);
+			ModelUpperSeries->append(n, time + interval);
+			ModelLowerSeries->append(n, qMax(0.0, time - interval));
+		}
+		qreal peak = model.peak();
+		if (peak >= 1 && peak <= AngleTickNumber + 1) PeakSeries->append(peak, model.taskTime(peak));
+		chart()->update();
+	}
 	void addOverloadPoint(int tick, qreal point)
 	{
 		if (tick <= AngleTickNumber && tick >= 1)
@@ -1060,6 +2407,7 @@ public:
 		//thread base settings
 		ThreadGlobalBase.clear();
 		ThreadLocalBase.clear();
+		clearClassBase();
 
 		//chart settings
 		QChart* chart = new QChart();
@@ -1072,6 +2420,12 @@ public:
 		TaskAxis->setLabelFormat("%." + QString::number(PerformancePrecision-1) + "f");
 		TaskAxis->setTitleText("Performance, tasks/sec");
 
+		RatioAxis = new QValueAxis;
+		RatioAxis->setRange(0.0, 1.0);
+		RatioAxis->setTickCount(6);
+		RatioAxis->setLabelFormat("%.1f");
+		RatioAxis->setTitleText("Ratio");
+
 		ThreadAxis = new QBarCategoryAxis;
 		//ThreadAxis->setTitleText("Thread");
 		ThreadAxis->setLabelsAngle(-90);
@@ -1086,13 +2440,41 @@ public:
 		ThreadSeries->setLabelsPosition(QAbstractBarSeries::LabelsOutsideEnd);
 		ThreadSeries->setLabelsAngle(-45);
 
+		ThreadRatioSeries = new QLineSeries();
+		ThreadRatioSeries->setName("CPU/Wall");
+		ThreadRatioSeries->setPointsVisible(true);
+
+		ThreadIpcSet = new QBarSet("IPC");
+		ThreadMissSet = new QBarSet("LLC MPKI");
+
+		CounterSeries = new QBarSeries();
+		CounterSeries->append(ThreadIpcSet);
+		CounterSeries->append(ThreadMissSet);
+
+		ThreadDelaySeries = new QLineSeries();
+		ThreadDelaySeries->setName("RQ Wait");
+		ThreadDelaySeries->setPointsVisible(true);
+
 		chart->addAxis(ThreadAxis, Qt::AlignBottom);
 		chart->addAxis(TaskAxis, Qt::AlignLeft);
+		chart->addAxis(RatioAxis, Qt::AlignRight);
 
 		chart->addSeries(ThreadSeries);
 		ThreadSeries->attachAxis(ThreadAxis);
 		ThreadSeries->attachAxis(TaskAxis);
 
+		chart->addSeries(ThreadRatioSeries);
+		ThreadRatioSeries->attachAxis(ThreadAxis);
+		ThreadRatioSeries->attachAxis(RatioAxis);
+
+		chart->addSeries(CounterSeries);
+		CounterSeries->attachAxis(ThreadAxis);
+		CounterSeries->attachAxis(RatioAxis);
+
+		chart->addSeries(ThreadDelaySeries);
+		ThreadDelaySeries->attachAxis(ThreadAxis);
+		ThreadDelaySeries->attachAxis(RatioAxis);
+
 		//chart->legend()->hide();
 		chart->setMargins(QMargins(15, 5, 15, 15));
 		chart->setAnimationOptions(QChart::NoAnimation);
@@ -1125,6 +2507,7 @@ public:
 	inline int checkThread(ThreadState thread_state); // checks the existence of certain thread in ThreadBase, returns its thread_id or -1 if no instance is found
 	inline void clearChart(); // clears all chart data
 	inline void clearBase(); // clears all base data
+	void clearClassBase() { ClassBase.clear(); ClassClock.start(); ClassLocalClock.start(); } // clears workload class data
 	void setTaskAxisCalibrated(int scale)
 	{
 		if (scale < 10 && scale > -10)
@@ -1190,6 +2573,50 @@ public slots:
 				overall_performance += ThreadLocalBase[i].getPerformanceRound(PerformancePrecision);
 		}
 		emit(sendOverallPerformance(overall_performance));
+
+		// performance of every numa node (pinned threads only)
+		QVector<qreal> node_performance;
+		for (uint i = 0; i < ThreadBaseLength; i++)
+		{
+			int node = ThreadGlobalBase[i].getNode();
+			if (!ThreadGlobalBase[i].isKilled() && node >= 0)
+			{
+				if (node >= node_performance.count()) node_performance.resize(node + 1);
+				node_performance[node] += ThreadLocalBase[i].getPerformanceRound(PerformancePrecision);
+			}
+		}
+		for (int node = 0; node < node_performance.count(); node++)
+			emit(sendNodePerformance(node, node_performance[node]));
+
+		// performance and latency of every workload class (last chart update)
+		if (ClassBase.count() > 1)
+		{
+			for (int class_id = 0; class_id < ClassBase.count(); class_id++)
+				emit(sendClassPerformance(class_id, ClassBase[class_id].Name, ClassBase[class_id].Performance, ClassBase[class_id].Latency));
+		}
+	}
+	void addFinishedClassTask(TaskInfo task_info)
+	{
+		int class_id = task_info.getClassId();
+		while (ClassBase.count() <= class_id) ClassBase.append(ClassState());
+		ClassBase[class_id].Name = task_info.getClassName();
+		ClassBase[class_id].Tasks++;
+		ClassBase[class_id].LocalTasks++;
+		ClassBase[class_id].LocalLatency += task_info.getLatency();
+		if (task_info.hasDeadline())
+		{
+			ClassBase[class_id].LocalDeadlines++;
+			if (task_info.isMissed()) ClassBase[class_id].LocalMisses++;
+		}
+	}
+	void setThreadDelay(qint64 tid, qreal delay)
+	{
+		ThreadDelayBase.insert(tid, delay);
+	}
+	void setTotalDelay(qreal ms, qreal delay)
+	{
+		Q_UNUSED(delay);
+		chart()->setTitle("Run queue wait: " + QString::number(ms, 'f', 1) + " ms/sec");
 	}
 
 protected:
@@ -1226,6 +2653,28 @@ private:
 	QBarSeries* ThreadSeries;
 	QBarSet* ThreadLocalSet;
 	QValueAxis* TaskAxis;
+	QValueAxis* RatioAxis;
+	QLineSeries* ThreadRatioSeries; // cpu to wall time ratio of every thread (local data)
+	QBarSeries* CounterSeries; // hardware counter bars on the ratio axis (0 - no counters)
+	QBarSet* ThreadIpcSet; // instructions per cycle of every thread (local data, hardware counters only)
+	QBarSet* ThreadMissSet; // llc misses per 1000 instructions of every thread (local data, hardware counters only)
+	QLineSeries* ThreadDelaySeries; // share of time every thread was waiting in the run queue (last schedstat sample)
+	QMap<qint64, qreal> ThreadDelayBase; // last run queue wait share by kernel thread id
+	struct ClassState
+	{
+		QString Name;
+		quint64 Tasks = 0; // since clearing
+		quint64 LocalTasks = 0; // since the last chart update
+		qreal LocalLatency = 0.0; // ms, sum since the last chart update
+		quint64 LocalDeadlines = 0; // tasks with deadlines since the last chart update
+		quint64 LocalMisses = 0; // missed deadlines since the last chart update
+		qreal MissRate = -1.0; // share of missed deadlines of the last chart update (-1 - no deadlines)
+		qreal Performance = 0.0; // tasks per second of the last chart update
+		qreal Latency = 0.0; // ms, mean of the last chart update
+	};
+	QList<ClassState> ClassBase; // workload classes
+	QElapsedTimer ClassClock; // time since clearing the class base
+	QElapsedTimer ClassLocalClock; // time since the last chart update
 	QBarCategoryAxis* ThreadAxis;
 	QList<ThreadState> ThreadGlobalBase;
 	QList<ThreadState> ThreadLocalBase;
@@ -1239,10 +2688,13 @@ private:
 	inline int addNewThread(ThreadState thread_state); // adds information about new thread to ThreadBase
 	inline void killThread(uint thread_id);
 	inline void resizeTaskAxis(qreal ratio = 1.5);
+	inline void resizeRatioAxis(qreal scale = 1.25);
 	inline bool calibrateTaskAxis(qreal point);
 
 signals:
 	void sendOverallPerformance(qreal performance);
+	void sendNodePerformance(int node, qreal performance);
+	void sendClassPerformance(int class_id, QString name, qreal performance, qreal latency);
 };
 
 int BarChartView::checkThread(ThreadState thread_state)
@@ -1284,19 +2736,55 @@ void BarChartView::addChartPerformance()
 
 	for (int i = 0; i < last; i++)
 	{
-		if (ThreadAxisLabelFormat) { ThreadAxis->append(ThreadGlobalBase[i].getName() + " " + ThreadGlobalBase[i].getPriorityString()); }
-		else { ThreadAxis->append(ThreadGlobalBase[i].getName()); }
+		QString label = ThreadGlobalBase[i].getName();
+		if (!ThreadGlobalBase[i].getPlace().isEmpty()) { label += " " + ThreadGlobalBase[i].getPlace(); }
+		if (ThreadAxisLabelFormat) { label += " " + ThreadGlobalBase[i].getPriorityString(); }
+		ThreadAxis->append(label);
 		*ThreadGlobalSet << ThreadGlobalBase[i].getPerformanceRound(PerformancePrecision);
 		if (ThreadGlobalBase[i].isKilled())
 		{
 			*ThreadLocalSet << 0.0;
+			*ThreadIpcSet << 0.0;
+			*ThreadMissSet << 0.0;
+			ThreadRatioSeries->append(i, 0.0);
 		}
 		else
 		{
 			*ThreadLocalSet << ThreadLocalBase[i].getPerformanceRound(PerformancePrecision);
+			ThreadRatioSeries->append(i, ThreadLocalBase[i].getCpuRatio());
+			if (ThreadDelayBase.contains(ThreadGlobalBase[i].getTid()))
+				ThreadDelaySeries->append(i, ThreadDelayBase.value(ThreadGlobalBase[i].getTid()));
+			*ThreadIpcSet << (ThreadLocalBase[i].hasCounters() ? ThreadLocalBase[i].getIpc() : 0.0);
+			*ThreadMissSet << (ThreadLocalBase[i].hasCounters() ? ThreadLocalBase[i].getMissRate() : 0.0);
+		}
+	}
+
+	if (ClassBase.count() > 1) // several workload classes -> class bars after the threads, mean latency in the label
+	{
+		qreal global_seconds = ClassClock.elapsed() / 1000.0;
+		qreal local_seconds = ClassLocalClock.restart() / 1000.0;
+		qreal precision = pow(10, PerformancePrecision);
+		for (int class_id = 0; class_id < ClassBase.count(); class_id++)
+		{
+			ClassState& class_state = ClassBase[class_id];
+			if (local_seconds > 0) class_state.Performance = round(class_state.LocalTasks / local_seconds * precision) / precision;
+			if (class_state.LocalTasks > 0) class_state.Latency = class_state.LocalLatency / class_state.LocalTasks;
+			if (class_state.LocalDeadlines > 0) class_state.MissRate = (qreal)class_state.LocalMisses / class_state.LocalDeadlines;
+			class_state.LocalTasks = 0;
+			class_state.LocalLatency = 0.0;
+			class_state.LocalDeadlines = 0;
+			class_state.LocalMisses = 0;
+			QString label = class_state.Name + " " + QString::number(class_state.Latency, 'f', 1) + "ms";
+			if (class_state.MissRate >= 0) label += " " + QString::number(class_state.MissRate * 100, 'f', 0) + "%miss";
+			ThreadAxis->append(label);
+			*ThreadGlobalSet << ((global_seconds > 0) ? round(class_state.Tasks / global_seconds * precision) / precision : 0.0);
+			*ThreadLocalSet << class_state.Performance;
+			*ThreadIpcSet << 0.0;
+			*ThreadMissSet << 0.0;
 		}
 	}
 	resizeTaskAxis();
+	resizeRatioAxis();
 }
 
 void BarChartView::addThreadState(uint thread_id, ThreadState thread_state)
@@ -1350,6 +2838,10 @@ void BarChartView::clearChart()
 		ThreadGlobalSet->remove(0, length);
 		ThreadLocalSet->remove(0, length);
 	}
+	ThreadIpcSet->remove(0, ThreadIpcSet->count());
+	ThreadMissSet->remove(0, ThreadMissSet->count());
+	ThreadRatioSeries->clear();
+	ThreadDelaySeries->clear();
 	ThreadAxis->clear();
 }
 
@@ -1360,6 +2852,8 @@ void BarChartView::clearBase()
 		ThreadGlobalBase.clear();
 		ThreadLocalBase.clear();
 	}
+	ThreadDelayBase.clear();
+	clearClassBase();
 }
 
 void BarChartView::saveChart()
@@ -1372,12 +2866,20 @@ void BarChartView::saveChart()
 
 void BarChartView::resizeTaskAxis(qreal scale)
 {
+	QList<qreal> points;
 	uint last = ThreadGlobalBase.length();
 	for (int i = 0; i < last; i++)
 	{
-		if (TaskAxis->max() < scale * ThreadLocalBase[i].getPerformanceRound(PerformancePrecision))
+		points.append(ThreadLocalBase[i].getPerformanceRound(PerformancePrecision));
+	}
+	if (ClassBase.count() > 1)
+	{
+		foreach (ClassState class_state, ClassBase) points.append(class_state.Performance);
+	}
+	foreach (qreal point, points)
+	{
+		if (TaskAxis->max() < scale * point)
 		{
-			qreal point = ThreadLocalBase[i].getPerformanceRound(PerformancePrecision);
 			if (TaskScaleNumber == 0) // radial axis isn't not calibrated yet
 			{
 				calibrateTaskAxis(point);
@@ -1400,6 +2902,25 @@ void BarChartView::resizeTaskAxis(qreal scale)
 	}
 }
 
+void BarChartView::resizeRatioAxis(qreal scale)
+{
+	qreal point = 1.0 / scale; // cpu/wall ratio always fits
+	for (int i = 0; i < ThreadIpcSet->count(); i++)
+	{
+		point = qMax(point, ThreadIpcSet->at(i));
+	}
+	for (int i = 0; i < ThreadMissSet->count(); i++)
+	{
+		point = qMax(point, ThreadMissSet->at(i));
+	}
+	qreal max = ceil(point * scale * 2) / 2; // half units
+	if (max != RatioAxis->max())
+	{
+		RatioAxis->setMax(max);
+		chart()->update();
+	}
+}
+
 bool BarChartView::calibrateTaskAxis(qreal point)
 {
 	int base = 0;
@@ -1501,6 +3022,12 @@ public:
 	void setSystemLightMode() { if (System->setSystemMode(LoadControl::SystemLightMode)) InfoEdit->append("#change mode - light"); }
 	void setSystemHardMode() { if (System->setSystemMode(LoadControl::SystemHardMode)) InfoEdit->append("#change mode - hard"); }
 	void setSystemCriticalMode() { if (System->setSystemMode(LoadControl::SystemCriticalMode)) InfoEdit->append("#change mode - critical"); }
+	void setSystemBanditMode(ThreadBandit::BanditRule rule); // asks for the oracle throughput and switches to the bandit mode
+	void setSystemTrackingMode(LoadControl::TrackMetric metric); // asks for the target, rule and period and switches to the tracking mode
+	void setSystemSearchMode() { if (System->setSystemMode(LoadControl::SystemSearchMode)) InfoEdit->append("#change mode - search"); }
+	void setSystemUslMode() { if (System->setSystemMode(LoadControl::SystemUslMode)) InfoEdit->append("#change mode - usl"); }
+	void setSystemDeadlineMode() { if (System->setSystemMode(LoadControl::SystemDeadlineMode)) InfoEdit->append("#change mode - deadline"); }
+	void setSystemSloMode(); // asks for the tail latency target and switches to the slo mode
 
 	void init(); // setup GUI settings
 
@@ -1510,10 +3037,37 @@ public slots:
 	void changeState(); // switches program state between 'running' and 'waiting'
 	void addThread(); // adds one new thread to current running thread pool
 	void removeThread(qreal ms); // removes one running thread from thread pool
-	void finishTask(int ms); // processing signal 'finished' emitted from task manager
+	void finishTask(int ms, int cpu_ms); // processing signal 'finished' emitted from task manager
 	void addThreadManual() { addThread(); }; // manual adding one thread by user
 	void removeThreadManual() { removeThread(0.0); }; // manual removing one thread by user
 	void changeSystemState(int state); // switches system state between 'running' and 'waiting'
+	void changeCountersState(int state); // switches per thread perf counters on/off
+	void changePinningState(int state); // switches topology aware thread pinning on/off
+	void changeMemoryState(int state); // switches task work between cpu cycles and memory buffer streaming
+	void setSchedPolicy(SchedPolicy policy); // sets workers' scheduling class and reports the previous one
+	void setTaskQueues(QList<TaskQueue> queues); // sets workload classes sharing the threads
+	void setDispatchMode(TaskManager::DispatchMode mode); // switches between fair sharing and earliest deadline first
+	void finishInfo(TaskInfo task_info); // processing class and deadline of the finished task
+	void reportDeadlines(); // reports deadline miss rate and lateness of every class
+	void reportSlo(); // reports how often the tail latency target was met
+	void reportRegret(); // reports cumulative regret of the bandit mode
+	void reportTracking(); // reports steady state error of the tracking mode
+	QString getWorkloadName(); // work type and task classes (part of the profile key)
+	void warmStart(); // loads the profile of the host and workload before the start
+	void saveProfile(); // saves what the load control learned before it forgets it
+	void showDecisionLog(); // shows the last decisions of the load control with their reasons
+	void exportDecisionLog(); // writes the decisions to a csv file
+	void reportSchedPolicy(); // reports throughput and tail latency measured with the current scheduling class
+	void changeNoisyState(int state); // switches noisy neighbour load generator on/off
+	void changeCeiling(int ceiling); // processing host load monitor ceiling
+	void changeBudget(int budget); // processing core budget changes (affinity mask/cgroup quota)
+	void changeLimit(int limit); // processing thread limit of the load control (oversubscription of blocking threads)
+	void startBenchmark(int seconds = BENCHSECONDS, bool quit = false); // runs every mode on every scripted scenario for 'seconds' each (quit - closes the program after the table)
+	void stopBenchmark(); // drops the runs left
+	void nextBenchRun(); // finishes the current run and starts the next one
+	QString setBenchMode(LoadControl* control, int mode); // sets the mode of a run, returns its name
+	void startSimulation(int seconds = BENCHSIMSECONDS, quint32 seed = 1, bool quit = false); // runs the benchmark on the pool simulator ('seconds' of virtual time each, same seed - same table)
+	BenchResult simulateRun(BenchScenario scenario, int mode, int seconds, quint32 seed); // one scenario and mode on a fresh control and simulator
 protected:
 	void closeEvent(QCloseEvent* event)
 	{
@@ -1542,7 +3096,12 @@ protected:
 private:
 	TaskManager* MyTaskManager;
 	LoadControl* System;
+	SchedStatSampler* Sampler;
+	HostLoadMonitor* HostMonitor;
+	CoreBudgetMonitor* BudgetMonitor;
+	NoisyNeighbour* Noisy;
 	QMenu* SystemHelpMenu;
+	QAction* WarmStartAction;
 	QPushButton* StartButton;
 	QPushButton* AddButton;
 	QPushButton* RemoveButton;
@@ -1550,13 +3109,36 @@ private:
 	WindowControlCheckBox* StarDisplayBox;
 	WindowControlCheckBox* BarDisplayBox;
 	QCheckBox* SystemControlBox;
+	QCheckBox* NoisyBox;
+	QCheckBox* CountersBox;
+	QCheckBox* PinningBox;
+	QCheckBox* MemoryBox;
+	QPushButton* PolicyButton;
+	QMenu* PolicyHelpMenu;
+	QPushButton* ClassButton;
+	QMenu* ClassHelpMenu;
 	QTextEdit* InfoEdit;
 	LoadChartView* LoadChart;
 	StarChartView* StarScaleChart;
 	BarChartView* BarThreadChart;
 
 	bool IsRunning; // determines current program state
-	int PerfectThreadCount; // constant determined by QThread::IdealThreadCount
+	int PerfectThreadCount; // core budget determined by the affinity mask and cgroup quota
+	SchedPolicy CurrentPolicy; // workers' scheduling class
+	TimeHistogram PolicyHistogram; // task times with the current scheduling class
+	QElapsedTimer PolicyClock; // time with the current scheduling class
+	QList<DeadlineMeter> DeadlineMeters; // deadline metrics of every workload class
+	QVector<QPair<BenchScenario, int>> BenchRuns; // scenario and mode of every benchmark run
+	int BenchIndex = -1; // current run (-1 - no benchmark)
+	int BenchSeconds = BENCHSECONDS;
+	bool BenchQuit = false;
+	bool BenchWarmStart = true; // warm start setting to restore after the benchmark
+	BenchTable Bench;
+	BenchResult BenchCurrent;
+	int BenchChanges = 0; // thread changes of the current run
+	quint64 BenchTasks = 0; // tasks finished in the steady state of the current run
+	TimeHistogram BenchHistogram; // their times
+	QElapsedTimer BenchClock; // time since the start of the current run
 
 signals:
 	void closed();